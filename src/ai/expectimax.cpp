@@ -0,0 +1,459 @@
+#include "expectimax.h"
+
+#include <ai/heuristic.h>
+#include <ai/ntuple.h>
+#include <core/threes.h>
+#include <util/threadpool.h>
+
+#include <chrono>
+#include <float.h>
+#include <math.h>
+
+namespace
+{
+// alpha of a node without a bound, and what a node returns when it cannot beat its alpha
+const float g_lowest = -FLT_MAX;
+
+// max nodes between two looks at the clock; with the leaves below them, a few hundred microseconds of search
+const uint32_t g_clockInterval = 512;
+
+// a_first, then the other directions in their usual order
+uint8_t OrderedDirection(EDirections a_first, uint8_t a_index)
+{
+    const uint8_t first = (uint8_t)a_first;
+    if (a_first == EDirections::COUNT || a_index > first)
+    {
+        return a_index;
+    }
+    return a_index == 0 ? first : a_index - 1;
+}
+
+uint8_t CountLines(uint8_t a_lines)
+{
+    return (uint8_t)((a_lines & 1) + ((a_lines >> 1) & 1) + ((a_lines >> 2) & 1) + ((a_lines >> 3) & 1));
+}
+
+// ties go to the lower direction, so the order moves are tried in never changes the choice
+bool IsBetter(float a_value, uint8_t a_dir, float a_best, EDirections a_bestMove)
+{
+    return a_bestMove == EDirections::COUNT || a_value > a_best || (a_value == a_best && a_dir < (uint8_t)a_bestMove);
+}
+
+} // namespace
+
+Expectimax::Expectimax(const Config& a_cfg)
+    : m_cfg(a_cfg)
+    , m_tt(a_cfg.ttBytes)
+    , m_star1(a_cfg.star1 && !a_cfg.network)
+    , m_upperBound(Heuristic::MaxValue())
+    , m_timed(false)
+    , m_outOfTime(false)
+{
+    if (m_cfg.threads > 1)
+        m_pool.reset(new ThreadPool(m_cfg.threads));
+    m_contexts.resize(m_cfg.threads > 1 ? m_cfg.threads : 1);
+}
+
+Expectimax::~Expectimax()
+{
+}
+
+Expectimax::Result Expectimax::Search(const PackedBoard& a_board, uint8_t a_next, const Threes::DeckState& a_deck)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (Context& ctx : m_contexts)
+    {
+        ctx = Context();
+    }
+
+    Result result;
+    const int depth         = m_cfg.depth > 0 ? m_cfg.depth : 1;
+    uint8_t symmetry        = 0;
+    const PackedBoard board = m_cfg.symmetry ? a_board.Canonical(&symmetry) : a_board;
+    m_deadline              = start + std::chrono::milliseconds(m_cfg.timeLimit);
+    m_outOfTime             = false;
+    // without a time limit there is just the one iteration at full depth
+    for (int iteration = m_cfg.timeLimit > 0 ? 1 : depth; iteration <= depth; ++iteration)
+    {
+        // the first iteration always completes, so there is a move to answer with
+        m_timed = (m_cfg.timeLimit > 0 || m_cfg.cancel) && iteration > 1;
+        EDirections move;
+        float value;
+        if (m_pool)
+            value = SearchRoot(board, a_next, a_deck, (uint8_t)iteration, result.move, &move);
+        else
+            value = SearchMove(m_contexts[0], board, a_next, a_deck, (uint8_t)iteration, 1.0f, g_lowest, result.move, &move);
+        if (m_outOfTime)
+        {
+            result.timedOut = true;
+            break;
+        }
+        result.move  = move;
+        result.value = value;
+        result.depth = (uint8_t)iteration;
+    }
+    result.move = PackedBoard::TransformDirection(result.move, PackedBoard::InverseSymmetry(symmetry));
+    for (const Context& ctx : m_contexts)
+    {
+        result.nodes += ctx.nodes;
+        result.ttHits += ctx.ttHits;
+        result.ttProbes += ctx.ttProbes;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+Expectimax::Result Expectimax::EvaluateMoves(const PackedBoard& a_board, uint8_t a_next, const Threes::DeckState& a_deck, float* out_values)
+{
+    const auto start = std::chrono::steady_clock::now();
+    Context& ctx     = m_contexts[0];
+    ctx              = Context();
+
+    Result result;
+    const uint8_t depth     = m_cfg.depth > 0 ? m_cfg.depth : 1;
+    uint8_t symmetry        = 0;
+    const PackedBoard board = m_cfg.symmetry ? a_board.Canonical(&symmetry) : a_board;
+    m_timed                 = false;
+    m_outOfTime             = false;
+    for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+    {
+        out_values[dir] = g_lowest;
+    }
+    for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+    {
+        PackedBoard afterstate = board;
+        uint16_t moved;
+        if (!afterstate.Move((EDirections)dir, &moved))
+        {
+            continue;
+        }
+        // without an alpha every move gets its exact value, also with star1
+        const float value      = MoveReward(board, afterstate) + SearchSpawn(ctx, afterstate, (EDirections)dir, moved, a_next, a_deck, depth, 1.0f, g_lowest);
+        const EDirections move = PackedBoard::TransformDirection((EDirections)dir, PackedBoard::InverseSymmetry(symmetry));
+        out_values[(int)move]  = value;
+    }
+    for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+    {
+        if (out_values[dir] != g_lowest && IsBetter(out_values[dir], dir, result.value, result.move))
+        {
+            result.move  = (EDirections)dir;
+            result.value = out_values[dir];
+        }
+    }
+    result.depth    = depth;
+    result.nodes    = ctx.nodes;
+    result.ttHits   = ctx.ttHits;
+    result.ttProbes = ctx.ttProbes;
+    result.seconds  = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// same as SearchMove, but the subtrees below the root's chance nodes are farmed out to the thread pool first.
+// the sums are then formed in exactly the order SearchSpawn and SearchNext would use, keeping results bit identical.
+// a_board is already canonical if symmetries are folded.
+float Expectimax::SearchRoot(const PackedBoard& a_board, uint8_t a_next, const Threes::DeckState& a_deck, uint8_t a_depth, EDirections a_first, EDirections* out_move)
+{
+    Context& root      = m_contexts[0];
+    const bool cached  = m_tt.IsEnabled() && a_depth >= m_cfg.ttMinDepth;
+    const uint64_t key = cached ? TranspositionTable::Hash(a_board, a_next, a_deck.Index()) : 0;
+    ++root.nodes;
+    if (cached)
+    {
+        float value;
+        EDirections move;
+        if (ProbeCache(root, key, a_depth, value, move))
+        {
+            *out_move = move;
+            return value;
+        }
+    }
+
+    struct Branch
+    {
+        uint8_t lines;
+        uint8_t chances[PackedBoard::EXTENT];
+        float reward;
+    };
+    Branch branches[(int)EDirections::COUNT];
+    m_rootTasks.clear();
+    for (uint8_t i = 0; i < (uint8_t)EDirections::COUNT; ++i)
+    {
+        const uint8_t dir      = OrderedDirection(a_first, i);
+        PackedBoard afterstate = a_board;
+        uint16_t moved;
+        branches[dir].lines  = afterstate.Move((EDirections)dir, &moved) ? PackedBoard::MovedLines((EDirections)dir, moved) : 0;
+        branches[dir].reward = branches[dir].lines != 0 ? MoveReward(a_board, afterstate) : 0.0f;
+        for (uint8_t line = 0; line < PackedBoard::EXTENT; ++line)
+        {
+            if ((branches[dir].lines & (1 << line)) == 0)
+            {
+                continue;
+            }
+            RootTask task;
+            task.board = afterstate;
+            task.board.Set(PackedBoard::SpawnIndex((EDirections)dir, line), a_next);
+            task.value = 0.0f;
+            task.deck  = a_deck;
+            task.dir   = dir;
+            if (a_depth == 1)
+            {
+                // leaves: the spawned board itself is evaluated
+                task.next        = 0;
+                task.probability = 1.0f;
+                m_rootTasks.push_back(task);
+                branches[dir].chances[line] = 1;
+                continue;
+            }
+            Threes::TileChance chances[Threes::MAX_TILE_CHANCES];
+            const uint8_t n = Threes::CalculateTileChances(task.board, a_deck, chances);
+            for (uint8_t i = 0; i < n; ++i)
+            {
+                task.next        = chances[i].value;
+                task.deck        = a_deck.Drawn(chances[i].value);
+                task.probability = chances[i].probability;
+                m_rootTasks.push_back(task);
+            }
+            branches[dir].chances[line] = n;
+        }
+    }
+
+    m_pool->ParallelFor(m_rootTasks.size(), [&](size_t a_index, int a_thread) {
+        RootTask& task = m_rootTasks[a_index];
+        Context& ctx   = m_contexts[a_thread];
+        if (a_depth == 1)
+        {
+            ++ctx.nodes;
+            task.value = EvaluateLeaf(task.board);
+        }
+        else
+        {
+            // formed like SearchSpawn and SearchNext would, for the same cutoffs
+            const float probability = 1.0f / CountLines(branches[task.dir].lines) * task.probability;
+            task.value              = SearchMove(ctx, task.board, task.next, task.deck, a_depth - 1, probability, g_lowest, EDirections::COUNT, nullptr);
+        }
+    });
+    if (m_outOfTime.load(std::memory_order_relaxed))
+    {
+        return 0.0f;
+    }
+
+    float best           = 0.0f; // game over
+    EDirections bestMove = EDirections::COUNT;
+    const RootTask* task = m_rootTasks.data();
+    for (uint8_t i = 0; i < (uint8_t)EDirections::COUNT; ++i)
+    {
+        const uint8_t dir = OrderedDirection(a_first, i);
+        if (branches[dir].lines == 0)
+        {
+            continue;
+        }
+        float sum = 0.0f;
+        int n     = 0;
+        for (uint8_t line = 0; line < PackedBoard::EXTENT; ++line)
+        {
+            if ((branches[dir].lines & (1 << line)) == 0)
+            {
+                continue;
+            }
+            float value = 0.0f;
+            if (a_depth == 1)
+            {
+                value = task->value;
+                ++task;
+            }
+            else
+            {
+                for (uint8_t i = 0; i < branches[dir].chances[line]; ++i, ++task)
+                {
+                    value += task->probability * task->value;
+                }
+            }
+            sum += value;
+            ++n;
+        }
+        const float value = branches[dir].reward + sum / n;
+        if (IsBetter(value, dir, best, bestMove))
+        {
+            best     = value;
+            bestMove = (EDirections)dir;
+        }
+    }
+    if (cached && !m_outOfTime.load(std::memory_order_relaxed))
+        m_tt.Store(key, a_depth, best, bestMove);
+    *out_move = bestMove;
+    return best;
+}
+
+float Expectimax::SearchMove(Context& a_ctx, const PackedBoard& a_board, uint8_t a_next, const Threes::DeckState& a_deck, uint8_t a_depth, float a_probability, float a_alpha, EDirections a_first, EDirections* out_move)
+{
+    ++a_ctx.nodes;
+    if (IsOutOfTime(a_ctx))
+    {
+        // the whole iteration is thrown away, the value does not matter
+        return 0.0f;
+    }
+
+    // cached nodes are searched as their canonical board, which makes their value the same for every orientation
+    const bool cached = m_tt.IsEnabled() && a_depth >= m_cfg.ttMinDepth;
+    uint64_t key      = 0;
+    uint8_t symmetry  = 0;
+    PackedBoard board = a_board;
+    float probability = a_probability;
+    if (cached)
+    {
+        if (m_cfg.symmetry)
+            board = a_board.Canonical(&symmetry);
+        key = TranspositionTable::Hash(board, a_next, a_deck.Index());
+        if (m_cfg.cutoff > 0.0f)
+        {
+            // the subtree is searched as if reached with the power of two below a_probability, which joins the key
+            const int level = -ilogbf(a_probability);
+            probability     = ldexpf(1.0f, -level);
+            key ^= (uint64_t)level * 0x9E3779B97F4A7C15ULL;
+        }
+        float value;
+        EDirections move;
+        if (ProbeCache(a_ctx, key, a_depth, value, move))
+        {
+            if (out_move)
+                *out_move = PackedBoard::TransformDirection(move, PackedBoard::InverseSymmetry(symmetry));
+            return value;
+        }
+    }
+
+    float best           = 0.0f; // game over
+    EDirections bestMove = EDirections::COUNT;
+    for (uint8_t i = 0; i < (uint8_t)EDirections::COUNT; ++i)
+    {
+        const uint8_t dir      = OrderedDirection(a_first, i);
+        PackedBoard afterstate = board;
+        uint16_t moved;
+        if (!afterstate.Move((EDirections)dir, &moved))
+        {
+            continue;
+        }
+        // with star1 the other moves only need to be searched as far as it takes to tell they are no better
+        const float alpha  = m_star1 && bestMove != EDirections::COUNT && best > a_alpha ? best : a_alpha;
+        const float reward = MoveReward(board, afterstate);
+        const float value  = reward + SearchSpawn(a_ctx, afterstate, (EDirections)dir, moved, a_next, a_deck, a_depth, probability, alpha - reward);
+        if (IsBetter(value, dir, best, bestMove))
+        {
+            best     = value;
+            bestMove = (EDirections)dir;
+        }
+    }
+    // an unfinished subtree must not end up in the table, and neither must a bound of a node that failed low
+    if (cached && best > a_alpha && !m_outOfTime.load(std::memory_order_relaxed))
+        m_tt.Store(key, a_depth, best, bestMove);
+    if (out_move)
+        *out_move = PackedBoard::TransformDirection(bestMove, PackedBoard::InverseSymmetry(symmetry));
+    return best;
+}
+
+// star1: once the lines (or tiles) searched so far, with the best possible value for the rest, cannot beat a_alpha
+// the node is cut off. children get the alpha they would have to beat for their parent to have a chance.
+float Expectimax::SearchSpawn(Context& a_ctx, const PackedBoard& a_afterstate, EDirections a_dir, uint16_t a_moved, uint8_t a_next, const Threes::DeckState& a_deck, uint8_t a_depth, float a_probability, float a_alpha)
+{
+    const uint8_t lines = PackedBoard::MovedLines(a_dir, a_moved);
+    const uint8_t count = CountLines(lines);
+    const bool bounded  = m_star1 && a_alpha != g_lowest;
+    float sum           = 0.0f;
+    int n               = 0;
+    for (uint8_t line = 0; line < PackedBoard::EXTENT; ++line)
+    {
+        if ((lines & (1 << line)) == 0)
+        {
+            continue;
+        }
+        float alpha = g_lowest;
+        if (bounded)
+        {
+            alpha = a_alpha * count - sum - (count - n - 1) * m_upperBound;
+            if (alpha >= m_upperBound)
+                return g_lowest;
+        }
+        PackedBoard board = a_afterstate;
+        board.Set(PackedBoard::SpawnIndex(a_dir, line), a_next);
+        const float value = SearchNext(a_ctx, board, a_deck, a_depth - 1, a_probability / count, alpha);
+        if (bounded && value <= alpha)
+        {
+            return g_lowest;
+        }
+        sum += value;
+        ++n;
+    }
+    return sum / n;
+}
+
+float Expectimax::SearchNext(Context& a_ctx, const PackedBoard& a_board, const Threes::DeckState& a_deck, uint8_t a_depth, float a_probability, float a_alpha)
+{
+    if (a_depth == 0 || a_probability < m_cfg.cutoff)
+    {
+        ++a_ctx.nodes;
+        return EvaluateLeaf(a_board);
+    }
+
+    Threes::TileChance chances[Threes::MAX_TILE_CHANCES];
+    const uint8_t n    = Threes::CalculateTileChances(a_board, a_deck, chances);
+    const bool bounded = m_star1 && a_alpha != g_lowest;
+    float value        = 0.0f;
+    float remaining    = 1.0f;
+    for (uint8_t i = 0; i < n; ++i)
+    {
+        const float probability = chances[i].probability;
+        remaining -= probability;
+        float alpha = g_lowest;
+        if (bounded)
+        {
+            alpha = (a_alpha - value - remaining * m_upperBound) / probability;
+            if (alpha >= m_upperBound)
+                return g_lowest;
+        }
+        const float child = SearchMove(a_ctx, a_board, chances[i].value, a_deck.Drawn(chances[i].value), a_depth, a_probability * probability, alpha, EDirections::COUNT, nullptr);
+        if (bounded && child <= alpha)
+        {
+            return g_lowest;
+        }
+        value += probability * child;
+    }
+    return value;
+}
+
+float Expectimax::EvaluateLeaf(const PackedBoard& a_board) const
+{
+    return m_cfg.network ? m_cfg.network->EvaluateState(a_board) : Heuristic::Evaluate(a_board);
+}
+
+float Expectimax::MoveReward(const PackedBoard& a_board, const PackedBoard& a_afterstate) const
+{
+    return m_cfg.network ? NTupleNetwork::Reward(a_board, a_afterstate) : 0.0f;
+}
+
+bool Expectimax::ProbeCache(Context& a_ctx, uint64_t a_key, uint8_t a_depth, float& out_value, EDirections& out_move) const
+{
+    ++a_ctx.ttProbes;
+    if (!m_tt.Probe(a_key, a_depth, out_value, out_move))
+    {
+        return false;
+    }
+    ++a_ctx.ttHits;
+    return true;
+}
+
+bool Expectimax::IsOutOfTime(Context& a_ctx)
+{
+    if (!m_timed)
+    {
+        return false;
+    }
+    if (a_ctx.clock == 0)
+    {
+        a_ctx.clock = g_clockInterval;
+        if (m_cfg.cancel && m_cfg.cancel->load(std::memory_order_relaxed))
+            m_outOfTime.store(true, std::memory_order_relaxed);
+        else if (m_cfg.timeLimit > 0 && std::chrono::steady_clock::now() >= m_deadline)
+            m_outOfTime.store(true, std::memory_order_relaxed);
+    }
+    --a_ctx.clock;
+    return m_outOfTime.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <ai/transposition.h>
+#include <core/board.h>
+#include <core/threes.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct NTupleNetwork;
+struct ThreadPool;
+
+// depth limited expectimax over the real rules: max nodes pick a move, chance nodes average over the line
+// the next tile spawns in (uniform over all lines that moved, see Threes::PickRandomTarget) and over the
+// value of the tile drawn after it (see Threes::CalculateTileChances). with the deck known, the odds of the
+// drawn tile are exact and values that cannot come up any more are not searched at all.
+// with several threads the root is split into its (move, spawn line, next tile) subtrees, which are searched in
+// parallel against one shared transposition table and combined in the serial order, so the chosen move and its
+// value never depend on the thread count.
+// cached nodes are searched in their canonical orientation (see PackedBoard::Canonical), so all rotations and
+// reflections of a position share one table entry and one result.
+// with a time limit the search deepens one move at a time, starting each iteration with the best move of the
+// previous one, and answers with the deepest iteration that finished in time. timed results depend on the machine.
+// two optional prunings trade accuracy for speed: subtrees reached with a probability below `cutoff` are evaluated
+// statically, and star1 skips the rest of a chance node once even the best possible outcome of its remaining
+// children (Heuristic::MaxValue) cannot beat the best move so far. star1 still finds the best move; ties between
+// equally good moves go to the one searched first. the probability level of a node is part of its table key, so a
+// cutoff that prunes little (1e-4 at depth 4) splits the table entries and searches more nodes than none at all.
+struct Expectimax
+{
+    struct Config
+    {
+        uint8_t depth      = 3;        // moves looked ahead, the deepest iteration with a time limit
+        uint32_t timeLimit = 0;        // milliseconds per search, 0 searches exactly `depth`
+        size_t ttBytes     = 16 << 20; // transposition table size, 0 disables it
+        uint8_t ttMinDepth = 2;        // shallower nodes are cheaper to search than to look up
+        bool symmetry      = true;     // fold the 8 orientations of a board into one table entry
+        float cutoff       = 0.0f;     // probability below which subtrees are not searched, 0 searches all
+        bool star1         = false;    // bound pruning, needs the heuristic (ignored with a network)
+        int threads        = 1;        // including the calling thread
+
+        const NTupleNetwork* network    = nullptr; // leaf evaluation, the hand tuned Heuristic if null
+        const std::atomic<bool>* cancel = nullptr; // once set (by any thread), searches stop like at the time limit
+    };
+    struct Result
+    {
+        EDirections move  = EDirections::COUNT; // COUNT if no move is possible
+        float value       = 0.0f;               // expected evaluation after `depth` moves
+        uint8_t depth     = 0;                  // of the last completed iteration
+        bool timedOut     = false;              // an iteration was cut short by the time limit or a cancel
+        uint64_t nodes    = 0;
+        uint64_t ttHits   = 0;
+        uint64_t ttProbes = 0;
+        double seconds    = 0.0;
+
+        double NodesPerSecond() const { return seconds > 0.0 ? nodes / seconds : 0.0; }
+        double TTHitRate() const { return ttProbes > 0 ? (double)ttHits / ttProbes : 0.0; }
+    };
+
+    explicit Expectimax(const Config& a_cfg);
+    ~Expectimax();
+
+    Result Search(const PackedBoard& a_board, uint8_t a_next, const Threes::DeckState& a_deck);
+    Result Search(const PackedBoard& a_board, uint8_t a_next) { return Search(a_board, a_next, Threes::DeckState::Unknown()); }
+    // the value of every move at `depth` (-FLT_MAX for moves that are not possible), searched on the calling thread
+    // without time limit or cancel. the best of them is worth what Search returns
+    Result EvaluateMoves(const PackedBoard& a_board, uint8_t a_next, const Threes::DeckState& a_deck, float* out_values);
+    // the depth of the next searches (the deepest iteration with a time limit)
+    void SetDepth(uint8_t a_depth) { m_cfg.depth = a_depth; }
+    // entries survive between searches, so consecutive positions of one game profit from each other
+    const TranspositionTable& GetTranspositionTable() const { return m_tt; }
+
+private:
+    // per thread counters, merged into the Result once the search is done
+    struct Context
+    {
+        uint64_t nodes    = 0;
+        uint64_t ttHits   = 0;
+        uint64_t ttProbes = 0;
+        uint32_t clock    = 0; // max nodes left until the next look at the clock
+    };
+    // one root subtree: the board after a move and its spawn, searched with a known next tile
+    struct RootTask
+    {
+        PackedBoard board;
+        uint8_t next;
+        Threes::DeckState deck;
+        uint8_t dir;
+        float probability;
+        float value;
+    };
+
+    // a_deck: the cards left after a_next was drawn, a_first: the move to try first (COUNT for the natural order).
+    // a_probability: of reaching the node from the root. a_alpha: nodes whose value is at most a_alpha may
+    // return any value up to a_alpha instead (see star1).
+    float SearchRoot(const PackedBoard& a_board, uint8_t a_next, const Threes::DeckState& a_deck, uint8_t a_depth, EDirections a_first, EDirections* out_move);
+    float SearchMove(Context& a_ctx, const PackedBoard& a_board, uint8_t a_next, const Threes::DeckState& a_deck, uint8_t a_depth, float a_probability, float a_alpha, EDirections a_first, EDirections* out_move);
+    float SearchSpawn(Context& a_ctx, const PackedBoard& a_afterstate, EDirections a_dir, uint16_t a_moved, uint8_t a_next, const Threes::DeckState& a_deck, uint8_t a_depth, float a_probability, float a_alpha);
+    float SearchNext(Context& a_ctx, const PackedBoard& a_board, const Threes::DeckState& a_deck, uint8_t a_depth, float a_probability, float a_alpha);
+
+    float EvaluateLeaf(const PackedBoard& a_board) const;
+    // a network values a board by the reward still to come, so every move adds what it earned on the way.
+    // the heuristic scores whole boards and needs nothing added
+    float MoveReward(const PackedBoard& a_board, const PackedBoard& a_afterstate) const;
+    bool ProbeCache(Context& a_ctx, uint64_t a_key, uint8_t a_depth, float& out_value, EDirections& out_move) const;
+    // true once the time limit has passed or the search was cancelled, checked every few hundred max nodes
+    bool IsOutOfTime(Context& a_ctx);
+
+    Config m_cfg;
+    TranspositionTable m_tt;
+    std::unique_ptr<ThreadPool> m_pool;
+    std::vector<Context> m_contexts;
+    std::vector<RootTask> m_rootTasks;
+    bool m_star1;
+    float m_upperBound; // of any leaf, for star1
+    std::chrono::steady_clock::time_point m_deadline;
+    bool m_timed;                  // the current iteration may be cut short (by the time limit or a cancel)
+    std::atomic<bool> m_outOfTime; // set by whichever thread first sees the deadline pass
+};
@@ -0,0 +1,101 @@
+#include "heuristic.h"
+
+#include <math.h>
+
+namespace
+{
+const float LOST_PENALTY        = 200000.0f;
+const float EMPTY_WEIGHT        = 270.0f;
+const float MERGES_WEIGHT       = 700.0f;
+const float MONOTONICITY_POWER  = 4.0f;
+const float MONOTONICITY_WEIGHT = 47.0f;
+const float SUM_POWER           = 3.5f;
+const float SUM_WEIGHT          = 11.0f;
+
+float CalculateLineScore(uint32_t a_line)
+{
+    uint8_t v[PackedBoard::EXTENT];
+    float rank[PackedBoard::EXTENT];
+    for (int i = 0; i < PackedBoard::EXTENT; ++i)
+    {
+        v[i]    = (uint8_t)(((a_line >> (4 * i)) & 0xF) | (((a_line >> (16 + i)) & 1) << 4));
+        rank[i] = v[i] < 3 ? v[i] * 0.5f : (float)(v[i] - 2); // 1 and 2 are worth less than the 3 they become
+    }
+
+    float sum     = 0.0f;
+    int empty     = 0;
+    int merges    = 0;
+    float monoInc = 0.0f;
+    float monoDec = 0.0f;
+    for (int i = 0; i < PackedBoard::EXTENT; ++i)
+    {
+        sum += powf(rank[i], SUM_POWER);
+        empty += v[i] == 0;
+        if (i + 1 < PackedBoard::EXTENT)
+        {
+            const uint8_t a = v[i];
+            const uint8_t b = v[i + 1];
+            merges += (a != 0 && b != 0 && a + b == 3) || (a >= 3 && a == b);
+            const float pa = powf(rank[i], MONOTONICITY_POWER);
+            const float pb = powf(rank[i + 1], MONOTONICITY_POWER);
+            if (pa > pb)
+                monoDec += pa - pb;
+            else
+                monoInc += pb - pa;
+        }
+    }
+    return LOST_PENALTY +
+           EMPTY_WEIGHT * empty +
+           MERGES_WEIGHT * merges -
+           MONOTONICITY_WEIGHT * (monoInc < monoDec ? monoInc : monoDec) -
+           SUM_WEIGHT * sum;
+}
+
+static struct LineScores
+{
+    LineScores()
+        : max(0.0f)
+    {
+        for (uint32_t line = 0; line < LINE_COUNT; ++line)
+        {
+            scores[line] = CalculateLineScore(line);
+            if (scores[line] > max)
+                max = scores[line];
+        }
+    }
+
+    float Get(uint32_t a_line) const
+    {
+        return (a_line >> 16) == 0 ? scores[a_line] : CalculateLineScore(a_line);
+    }
+
+    enum
+    {
+        LINE_COUNT = 1 << 16
+    };
+    float scores[LINE_COUNT];
+    float max;
+} g_lineScores;
+
+float EvaluateRows(const PackedBoard& a_board)
+{
+    float score = 0.0f;
+    for (int row = 0; row < PackedBoard::EXTENT; ++row)
+    {
+        score += g_lineScores.Get(a_board.GetRow(row));
+    }
+    return score;
+}
+
+} // namespace
+
+float Heuristic::Evaluate(const PackedBoard& a_board)
+{
+    const float score = EvaluateRows(a_board) + EvaluateRows(a_board.Transposed());
+    return score > 0.0f ? score : 0.0f;
+}
+
+float Heuristic::MaxValue()
+{
+    return 2 * PackedBoard::EXTENT * g_lineScores.max;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <core/board.h>
+
+// hand tuned board evaluation: every row and column is scored for empty cells, possible merges,
+// monotonicity and the size of its tiles. per line scores are precomputed like the move tables.
+struct Heuristic
+{
+    // never negative, never above MaxValue()
+    static float Evaluate(const PackedBoard& a_board);
+    static float MaxValue();
+};
@@ -0,0 +1,111 @@
+#include "hint.h"
+
+HintEngine::HintEngine(const Expectimax::Config& a_cfg, Listener a_onHint)
+    : m_maxDepth(a_cfg.depth > 0 ? a_cfg.depth : 1)
+    , m_onHint(a_onHint)
+    , m_cancel(false)
+    , m_current(0)
+    , m_hint(0)
+    , m_solver(MakeSolverConfig(a_cfg, &m_cancel))
+    , m_generation(0)
+    , m_pending(false)
+    , m_quit(false)
+{
+    m_worker = std::thread(&HintEngine::WorkerLoop, this);
+}
+
+HintEngine::~HintEngine()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+        m_cancel.store(true, std::memory_order_relaxed);
+    }
+    m_wake.notify_one();
+    m_worker.join();
+}
+
+void HintEngine::SetPosition(const PackedBoard& a_board, uint8_t a_next, const Threes::DeckState& a_deck)
+{
+    {
+        // the cancel is raised under the lock, so it cannot hit the search of the position set here
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_position.board = a_board;
+        m_position.next  = a_next;
+        m_position.deck  = a_deck;
+        m_pending        = true;
+        m_current.store(++m_generation, std::memory_order_relaxed);
+        m_cancel.store(true, std::memory_order_relaxed);
+    }
+    m_wake.notify_one();
+}
+
+void HintEngine::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending = false;
+    m_current.store(++m_generation, std::memory_order_relaxed);
+    m_cancel.store(true, std::memory_order_relaxed);
+}
+
+HintEngine::Hint HintEngine::GetHint() const
+{
+    Hint hint;
+    const uint64_t packed = m_hint.load(std::memory_order_relaxed);
+    if ((uint32_t)(packed >> 32) == m_current.load(std::memory_order_relaxed))
+    {
+        hint.move  = (EDirections)(uint8_t)packed;
+        hint.depth = (uint8_t)(packed >> 8);
+    }
+    return hint;
+}
+
+void HintEngine::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_wake.wait(lock, [this] { return m_quit || m_pending; });
+        if (m_quit)
+        {
+            return;
+        }
+        const Position position   = m_position;
+        const uint32_t generation = m_generation;
+        m_pending                 = false;
+        m_cancel.store(false, std::memory_order_relaxed);
+
+        lock.unlock();
+        Solve(position, generation);
+        lock.lock();
+    }
+}
+
+void HintEngine::Solve(const Position& a_position, uint32_t a_generation)
+{
+    for (int depth = 1; depth <= m_maxDepth; ++depth)
+    {
+        m_solver.SetDepth((uint8_t)depth);
+        const Expectimax::Result result = m_solver.Search(a_position.board, a_position.next, a_position.deck);
+        if (result.timedOut || m_cancel.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        m_hint.store(((uint64_t)a_generation << 32) | ((uint64_t)depth << 8) | (uint8_t)result.move, std::memory_order_relaxed);
+        if (m_onHint)
+            m_onHint();
+        if (result.move == EDirections::COUNT)
+        {
+            // game over, deeper searches will not find a move either
+            return;
+        }
+    }
+}
+
+Expectimax::Config HintEngine::MakeSolverConfig(const Expectimax::Config& a_cfg, const std::atomic<bool>* a_cancel)
+{
+    Expectimax::Config cfg = a_cfg;
+    cfg.timeLimit          = 0;
+    cfg.cancel             = a_cancel;
+    return cfg;
+}
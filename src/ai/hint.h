@@ -0,0 +1,67 @@
+#pragma once
+
+#include <ai/expectimax.h>
+#include <core/board.h>
+#include <core/threes.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+
+// move suggestions computed on a worker thread: every new position is searched one move deeper at a time, each
+// finished depth replacing the hint. a new position cancels the running search within a fraction of a millisecond,
+// the transposition table is kept, so the subtree of the previous position is found again.
+// SetPosition, Clear and GetHint are meant for one (the game's) thread and never wait for the search.
+struct HintEngine
+{
+    struct Hint
+    {
+        EDirections move = EDirections::COUNT; // COUNT while nothing is known (yet)
+        uint8_t depth    = 0;
+
+        bool operator==(const Hint& a_other) const { return move == a_other.move && depth == a_other.depth; }
+        bool operator!=(const Hint& a_other) const { return !(*this == a_other); }
+    };
+
+    typedef std::function<void()> Listener;
+
+    // a_cfg.depth is the deepest search, the time limit is ignored. a_onHint is called on the worker thread
+    // whenever GetHint has a new answer, e.g. to wake up a game that waits for input
+    explicit HintEngine(const Expectimax::Config& a_cfg, Listener a_onHint = nullptr);
+    ~HintEngine();
+
+    void SetPosition(const PackedBoard& a_board, uint8_t a_next, const Threes::DeckState& a_deck);
+    // stops searching, e.g. once the game is over
+    void Clear();
+    // the deepest answer for the current position so far
+    Hint GetHint() const;
+
+private:
+    struct Position
+    {
+        PackedBoard board;
+        uint8_t next;
+        Threes::DeckState deck;
+    };
+
+    void WorkerLoop();
+    void Solve(const Position& a_position, uint32_t a_generation);
+    static Expectimax::Config MakeSolverConfig(const Expectimax::Config& a_cfg, const std::atomic<bool>* a_cancel);
+
+    uint8_t m_maxDepth;
+    const Listener m_onHint;
+    std::atomic<bool> m_cancel;      // set with every new position, the worker clears it when it picks one up
+    std::atomic<uint32_t> m_current; // generation of the position the game shows
+    std::atomic<uint64_t> m_hint;    // generation << 32 | depth << 8 | move
+    Expectimax m_solver;             // only used by the worker
+
+    std::mutex m_mutex; // guards the fields below
+    std::condition_variable m_wake;
+    Position m_position;
+    uint32_t m_generation;
+    bool m_pending;
+    bool m_quit;
+    std::thread m_worker;
+};
@@ -0,0 +1,293 @@
+#include "mcts.h"
+
+#include <core/threes.h>
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+
+MCTS::MCTS(const Config& a_cfg)
+    : m_cfg(a_cfg)
+    , m_random(0ULL, 0ULL)
+    , m_root(nullptr)
+    , m_treeNodes(0)
+    , m_valueScale(1.0f)
+{
+    Reset(0);
+}
+
+void MCTS::Reset(uint64_t a_seed)
+{
+    m_arena.Reset();
+    m_random     = Random(a_seed, 0ULL);
+    m_root       = nullptr;
+    m_treeNodes  = 0;
+    m_valueScale = 1.0f;
+}
+
+MCTS::Result MCTS::Search(const PackedBoard& a_board, uint8_t a_next, const Threes::DeckState& a_deck)
+{
+    const auto start = std::chrono::steady_clock::now();
+    if (m_root && (m_root->board != a_board || m_root->next != a_next || m_root->deck != a_deck))
+    {
+        m_root = nullptr;
+    }
+    // an iteration adds at most one node and expands one: start over unless this search surely fits. a tree
+    // that would not fit twice is kept at half the budget, so some of it is still reused
+    const size_t perIteration = sizeof(Node) + (size_t)EDirections::COUNT * sizeof(ChanceNode);
+    const size_t reserve      = std::min((size_t)m_cfg.iterations * perIteration, m_cfg.maxBytes / 2);
+    if (!m_root || m_arena.GetBytesUsed() + reserve > m_cfg.maxBytes)
+    {
+        // unreachable nodes are only reclaimed in bulk
+        m_arena.Reset();
+        m_treeNodes = 0;
+        m_root      = NewNode(a_board, a_next, a_deck, 0);
+    }
+
+    Result result;
+    result.reused        = m_root->visits;
+    const uint64_t nodes = m_treeNodes;
+    for (uint32_t i = 0; i < m_cfg.iterations; ++i)
+    {
+        m_path.clear();
+        m_chancePath.clear();
+
+        // selection and expansion: down to a node visited for the first time, a lost game or a full arena
+        Node* node  = m_root;
+        float value = 0.0f;
+        while (true)
+        {
+            m_path.push_back(node);
+            if (node->visits == 0 || !Expand(node))
+            {
+                value = Playout(node->board, node->next, node->deck);
+                break;
+            }
+            if (node->moveCount == 0)
+            {
+                value = (float)node->board.Score();
+                break;
+            }
+            ChanceNode* chance = Select(node);
+            m_chancePath.push_back(chance);
+            PackedBoard board;
+            uint8_t next;
+            Threes::DeckState deck;
+            Node* child = Sample(chance, board, next, deck);
+            if (!child)
+            {
+                value = Playout(board, next, deck);
+                break;
+            }
+            node = child;
+        }
+        if (value > m_valueScale)
+            m_valueScale = value;
+
+        for (Node* visited : m_path)
+        {
+            ++visited->visits;
+            visited->value += value;
+        }
+        for (ChanceNode* visited : m_chancePath)
+        {
+            ++visited->visits;
+            visited->value += value;
+        }
+    }
+
+    // the most visited move is the most robust choice
+    const ChanceNode* best = nullptr;
+    for (uint8_t i = 0; i < m_root->moveCount; ++i)
+    {
+        const ChanceNode& chance = m_root->moves[i];
+        if (!best || chance.visits > best->visits)
+            best = &chance;
+    }
+    if (best)
+    {
+        result.move  = (EDirections)best->dir;
+        result.value = best->visits > 0 ? (float)(best->value / best->visits) : 0.0f;
+    }
+    result.nodes     = m_treeNodes - nodes;
+    result.treeNodes = m_treeNodes;
+    result.bytes     = m_arena.GetBytesUsed();
+    result.seconds   = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void MCTS::Advance(EDirections a_dir, const PackedBoard& a_board, uint8_t a_next, const Threes::DeckState& a_deck)
+{
+    Node* next = nullptr;
+    if (m_root && m_root->expanded)
+    {
+        for (uint8_t i = 0; i < m_root->moveCount && !next; ++i)
+        {
+            if (m_root->moves[i].dir != (uint8_t)a_dir)
+                continue;
+            for (Node* child = m_root->moves[i].children; child && !next; child = child->sibling)
+            {
+                if (child->board == a_board && child->next == a_next && child->deck == a_deck)
+                    next = child;
+            }
+        }
+    }
+    // without a match the next Search starts over
+    m_root = next;
+}
+
+MCTS::Node* MCTS::NewNode(const PackedBoard& a_board, uint8_t a_next, const Threes::DeckState& a_deck, uint8_t a_spawnLine)
+{
+    Node* node = m_arena.GetBytesUsed() + sizeof(Node) <= m_cfg.maxBytes ? m_arena.New<Node>() : nullptr;
+    if (!node)
+    {
+        return nullptr;
+    }
+    node->board     = a_board;
+    node->next      = a_next;
+    node->deck      = a_deck;
+    node->spawnLine = a_spawnLine;
+    ++m_treeNodes;
+    return node;
+}
+
+// creates the chance nodes of all legal moves on the second visit, leaves that are never revisited stay small
+bool MCTS::Expand(Node* a_node)
+{
+    if (a_node->expanded)
+    {
+        return true;
+    }
+    if (m_arena.GetBytesUsed() + (size_t)EDirections::COUNT * sizeof(ChanceNode) > m_cfg.maxBytes)
+    {
+        return false;
+    }
+    ChanceNode moves[(int)EDirections::COUNT];
+    uint8_t n = 0;
+    for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+    {
+        PackedBoard afterstate = a_node->board;
+        uint16_t moved;
+        if (afterstate.Move((EDirections)dir, &moved))
+        {
+            ChanceNode& chance = moves[n++];
+            chance.afterstate  = afterstate;
+            chance.dir         = dir;
+            chance.lines       = PackedBoard::MovedLines((EDirections)dir, moved);
+            chance.visits      = 0;
+            chance.value       = 0.0;
+            chance.children    = nullptr;
+        }
+    }
+    if (n > 0)
+    {
+        a_node->moves = m_arena.NewArray<ChanceNode>(n);
+        if (!a_node->moves)
+        {
+            return false;
+        }
+        for (uint8_t i = 0; i < n; ++i)
+        {
+            a_node->moves[i] = moves[i];
+        }
+        m_treeNodes += n;
+    }
+    a_node->moveCount = n;
+    a_node->expanded  = true;
+    return true;
+}
+
+MCTS::ChanceNode* MCTS::Select(const Node* a_node) const
+{
+    const float logVisits = logf((float)a_node->visits);
+    ChanceNode* best      = nullptr;
+    float bestScore       = 0.0f;
+    for (uint8_t i = 0; i < a_node->moveCount; ++i)
+    {
+        ChanceNode* chance = a_node->moves + i;
+        if (chance->visits == 0)
+        {
+            return chance;
+        }
+        const float mean  = (float)(chance->value / chance->visits) / m_valueScale;
+        const float score = mean + m_cfg.exploration * sqrtf(logVisits / chance->visits);
+        if (!best || score > bestScore)
+        {
+            best      = chance;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+MCTS::Node* MCTS::Sample(ChanceNode* a_chance, PackedBoard& out_board, uint8_t& out_next, Threes::DeckState& out_deck)
+{
+    const Node* parent = m_path.back();
+
+    // the spawn line is uniform over the lines that moved, see Threes::PickRandomTarget
+    uint8_t lines[PackedBoard::EXTENT];
+    uint8_t n = 0;
+    for (uint8_t line = 0; line < PackedBoard::EXTENT; ++line)
+    {
+        if (a_chance->lines & (1 << line))
+            lines[n++] = line;
+    }
+    const uint8_t line = lines[m_random.Next() % n];
+    out_board          = a_chance->afterstate;
+    out_board.Set(PackedBoard::SpawnIndex((EDirections)a_chance->dir, line), parent->next);
+    out_deck = parent->deck;
+    out_next = SampleNext(out_board, out_deck);
+
+    // the deck follows from the parent's deck and the drawn tile, so line and tile identify the child
+    for (Node* child = a_chance->children; child; child = child->sibling)
+    {
+        if (child->spawnLine == line && child->next == out_next)
+            return child;
+    }
+    Node* child = NewNode(out_board, out_next, out_deck, line);
+    if (child)
+    {
+        child->sibling     = a_chance->children;
+        a_chance->children = child;
+    }
+    return child;
+}
+
+uint8_t MCTS::SampleNext(const PackedBoard& a_board, Threes::DeckState& io_deck)
+{
+    Threes::TileChance chances[Threes::MAX_TILE_CHANCES];
+    const uint8_t n = Threes::CalculateTileChances(a_board, io_deck, chances);
+    float roll      = (m_random.Next() >> 8) * (1.0f / (1 << 24));
+    uint8_t i       = 0;
+    for (; i + 1 < n; ++i)
+    {
+        roll -= chances[i].probability;
+        if (roll < 0.0f)
+            break;
+    }
+    io_deck = io_deck.Drawn(chances[i].value);
+    return chances[i].value;
+}
+
+float MCTS::Playout(PackedBoard a_board, uint8_t a_next, Threes::DeckState a_deck)
+{
+    while (!a_board.IsGameOver())
+    {
+        uint16_t moved;
+        EDirections dir;
+        do
+        {
+            dir = (EDirections)(m_random.Next() % (uint32_t)EDirections::COUNT);
+        } while (!a_board.Move(dir, &moved));
+
+        const uint8_t lines = PackedBoard::MovedLines(dir, moved);
+        uint8_t line;
+        do
+        {
+            line = (uint8_t)(m_random.Next() % PackedBoard::EXTENT);
+        } while ((lines & (1 << line)) == 0);
+        a_board.Set(PackedBoard::SpawnIndex(dir, line), a_next);
+        a_next = SampleNext(a_board, a_deck);
+    }
+    return (float)a_board.Score();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <core/board.h>
+#include <core/random.h>
+#include <core/threes.h>
+#include <util/arena.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// monte carlo tree search: decision nodes (board, next tile and deck) pick a move by UCT, chance nodes (the afterstate
+// of a move) sample the spawn line and the tile drawn after it. new nodes are scored by a random playout to game over.
+// nodes live in an arena that is only cleared by Reset() or before a search that might not fit into it; after a real
+// move Advance() keeps the subtree of the position that actually came up.
+struct MCTS
+{
+    struct Config
+    {
+        uint32_t iterations = 2000;     // per Search
+        float exploration   = 1.0f;     // UCT constant, values are normalized to the best playout seen
+        size_t maxBytes     = 64 << 20; // node memory; the tree is dropped before a search that could exceed it
+    };
+    struct Result
+    {
+        EDirections move   = EDirections::COUNT; // COUNT if no move is possible
+        float value        = 0.0f;               // mean playout score below the chosen move
+        uint32_t reused    = 0;                  // root visits carried over from earlier searches
+        uint64_t nodes     = 0;                  // created by this search
+        uint64_t treeNodes = 0;                  // in the arena
+        size_t bytes       = 0;                  // arena memory in use
+        double seconds     = 0.0;
+
+        double NodesPerSecond() const { return seconds > 0.0 ? nodes / seconds : 0.0; }
+        double BytesPerNode() const { return treeNodes > 0 ? (double)bytes / treeNodes : 0.0; }
+    };
+
+    explicit MCTS(const Config& a_cfg);
+
+    // drops the tree (e.g. for a new game) and restarts the random draws from a_seed
+    void Reset(uint64_t a_seed);
+    Result Search(const PackedBoard& a_board, uint8_t a_next, const Threes::DeckState& a_deck);
+    // the real game moved in a_dir and came out as a_board with a_next and a_deck: the matching subtree becomes the root
+    void Advance(EDirections a_dir, const PackedBoard& a_board, uint8_t a_next, const Threes::DeckState& a_deck);
+
+private:
+    struct Node;
+    struct ChanceNode
+    {
+        PackedBoard afterstate;
+        uint8_t dir;
+        uint8_t lines; // the lines the spawn may enter, see PackedBoard::MovedLines
+        uint32_t visits;
+        double value;
+        Node* children; // linked through Node::sibling
+    };
+    struct Node
+    {
+        PackedBoard board;
+        uint8_t next;
+        Threes::DeckState deck; // left after drawing next
+        uint8_t spawnLine;
+        uint8_t moveCount; // 0 until expanded (or if the game is over)
+        bool expanded;
+        uint32_t visits;
+        double value;
+        ChanceNode* moves;
+        Node* sibling;
+    };
+
+    Node* NewNode(const PackedBoard& a_board, uint8_t a_next, const Threes::DeckState& a_deck, uint8_t a_spawnLine);
+    bool Expand(Node* a_node);
+    ChanceNode* Select(const Node* a_node) const;
+    // the child for a randomly drawn spawn, nullptr if it would not fit into memory (the out_ values are set anyway)
+    Node* Sample(ChanceNode* a_chance, PackedBoard& out_board, uint8_t& out_next, Threes::DeckState& out_deck);
+    // draws the next tile for a_board, removing it from io_deck
+    uint8_t SampleNext(const PackedBoard& a_board, Threes::DeckState& io_deck);
+    float Playout(PackedBoard a_board, uint8_t a_next, Threes::DeckState a_deck);
+
+    Config m_cfg;
+    Arena m_arena;
+    Random m_random;
+    Node* m_root;
+    uint64_t m_treeNodes;
+    float m_valueScale;
+    std::vector<Node*> m_path;
+    std::vector<ChanceNode*> m_chancePath;
+};
@@ -0,0 +1,141 @@
+#include "montecarlo.h"
+
+#include <core/threes.h>
+#include <util/threadpool.h>
+
+#include <chrono>
+#include <math.h>
+
+namespace
+{
+struct MoveStats
+{
+    uint32_t n   = 0;
+    double sum   = 0.0;
+    double sumSq = 0.0;
+
+    double Mean() const { return n > 0 ? sum / n : 0.0; }
+    double StandardError() const
+    {
+        if (n < 2)
+            return 0.0;
+        const double mean     = Mean();
+        const double variance = (sumSq - n * mean * mean) / (n - 1);
+        return variance > 0.0 ? sqrt(variance / n) : 0.0;
+    }
+};
+
+} // namespace
+
+MonteCarlo::MonteCarlo(const Config& a_cfg)
+    : m_cfg(a_cfg)
+    , m_searches(0)
+{
+    if (m_cfg.batch == 0)
+        m_cfg.batch = 1;
+    m_pool.reset(new ThreadPool(m_cfg.threads > 1 ? m_cfg.threads : 1));
+}
+
+MonteCarlo::~MonteCarlo()
+{
+}
+
+MonteCarlo::Result MonteCarlo::Search(const Threes& a_game)
+{
+    const auto start      = std::chrono::steady_clock::now();
+    const uint64_t search = m_searches++;
+
+    Result result;
+    uint8_t legal[(int)EDirections::COUNT];
+    uint8_t legalCount = 0;
+    for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+    {
+        if (a_game.board.CanMove((EDirections)dir))
+            legal[legalCount++] = dir;
+    }
+    if (legalCount <= 1)
+    {
+        // nothing to compare
+        result.move    = legalCount == 1 ? (EDirections)legal[0] : EDirections::COUNT;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+    MoveStats stats[(int)EDirections::COUNT];
+    uint64_t stream = 0;
+    for (uint32_t played = 0; played < m_cfg.playouts;)
+    {
+        const uint32_t batch = m_cfg.playouts - played < m_cfg.batch ? m_cfg.playouts - played : m_cfg.batch;
+        m_playouts.resize((size_t)batch * legalCount);
+        for (size_t i = 0; i < m_playouts.size(); ++i)
+        {
+            m_playouts[i].dir = legal[i % legalCount];
+        }
+
+        // playout i of the round always draws from stream (first + i), whatever thread runs it
+        const uint64_t first = (search << 32) + stream;
+        m_pool->ParallelFor(m_playouts.size(), [&](size_t a_index, int) {
+            Play(a_game, first + a_index, m_playouts[a_index]);
+        });
+        stream += m_playouts.size();
+        played += batch;
+
+        for (const Playout& playout : m_playouts)
+        {
+            MoveStats& s = stats[playout.dir];
+            ++s.n;
+            s.sum += playout.score;
+            s.sumSq += (double)playout.score * playout.score;
+            result.moves += playout.moves;
+        }
+        result.playouts += m_playouts.size();
+
+        uint8_t best = legal[0];
+        for (uint8_t i = 1; i < legalCount; ++i)
+        {
+            if (stats[legal[i]].Mean() > stats[best].Mean())
+                best = legal[i];
+        }
+        result.move  = (EDirections)best;
+        result.value = (float)stats[best].Mean();
+
+        if (m_cfg.confidence > 0.0f)
+        {
+            const double lower = stats[best].Mean() - m_cfg.confidence * stats[best].StandardError();
+            bool clear         = true;
+            for (uint8_t i = 0; i < legalCount && clear; ++i)
+            {
+                const MoveStats& other = stats[legal[i]];
+                if (legal[i] != best)
+                    clear = other.Mean() + m_cfg.confidence * other.StandardError() < lower;
+            }
+            if (clear && played < m_cfg.playouts)
+            {
+                result.stoppedEarly = true;
+                break;
+            }
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void MonteCarlo::Play(const Threes& a_game, uint64_t a_stream, Playout& a_playout) const
+{
+    Threes game = a_game;
+    game.Reseed(Random(m_cfg.seed, a_stream));
+    Random policy(m_cfg.seed, ~a_stream);
+
+    uint32_t moves = 0;
+    game.Move((EDirections)a_playout.dir);
+    while (!game.IsGameOver())
+    {
+        // uniform over the legal moves: draw until one moves, the game not being over guarantees one does
+        while (!game.Move((EDirections)(policy.Next() % (uint32_t)EDirections::COUNT)))
+        {
+        }
+        ++moves;
+    }
+    a_playout.score = game.board.Score();
+    a_playout.moves = moves + 1;
+}
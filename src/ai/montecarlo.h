@@ -0,0 +1,58 @@
+#pragma once
+
+#include <core/board.h>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct Threes;
+struct ThreadPool;
+
+// pure monte carlo move selection: every legal move gets random playouts to game over (random moves, freshly
+// drawn spawns and tiles) and the move with the best mean final score wins. playouts run in rounds of `batch`
+// per move spread over the threads; once the best move's mean is `confidence` standard errors clear of every
+// other move's, the remaining rounds are skipped.
+// results depend on the seed and the number of searches run so far, never on the thread count.
+struct MonteCarlo
+{
+    struct Config
+    {
+        uint32_t playouts = 256;  // per move, at most
+        uint32_t batch    = 32;   // per move and round
+        float confidence  = 3.0f; // 0 never stops early
+        int threads       = 1;    // including the calling thread
+        uint64_t seed     = 1;
+    };
+    struct Result
+    {
+        EDirections move  = EDirections::COUNT; // COUNT if no move is possible
+        float value       = 0.0f;               // mean final score of the chosen move
+        uint64_t playouts = 0;
+        uint64_t moves    = 0; // played in all playouts together
+        double seconds    = 0.0;
+        bool stoppedEarly = false; // one move was clearly ahead before all playouts ran
+
+        double PlayoutsPerSecond() const { return seconds > 0.0 ? playouts / seconds : 0.0; }
+    };
+
+    explicit MonteCarlo(const Config& a_cfg);
+    ~MonteCarlo();
+
+    Result Search(const Threes& a_game);
+
+private:
+    struct Playout
+    {
+        uint8_t dir;
+        uint32_t score;
+        uint32_t moves;
+    };
+
+    void Play(const Threes& a_game, uint64_t a_stream, Playout& a_playout) const;
+
+    Config m_cfg;
+    std::unique_ptr<ThreadPool> m_pool; // without workers for a single thread
+    std::vector<Playout> m_playouts;
+    uint64_t m_searches;
+};
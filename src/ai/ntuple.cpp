@@ -0,0 +1,233 @@
+#include "ntuple.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+// file layout: magic, version, tuple count, entries per tuple, then the weights as little endian floats
+const char g_magic[4]          = { 'T', 'T', 'N', 'T' };
+const uint32_t g_formatVersion = 1;
+
+// tiles above 15 saturate to 15 instead of wrapping around
+uint64_t SaturatedNibbles(const PackedBoard& a_board)
+{
+    uint64_t lo = a_board.lo;
+    for (uint16_t hi = a_board.hi; hi != 0; hi &= hi - 1)
+    {
+        uint8_t i = 0;
+        while (((hi >> i) & 1) == 0)
+            ++i;
+        lo |= 0xFULL << (4 * i);
+    }
+    return lo;
+}
+
+float CalculateRankScore(uint32_t a_line)
+{
+    float score = 0.0f;
+    for (int i = 0; i < PackedBoard::EXTENT; ++i)
+    {
+        const uint8_t v = (uint8_t)(((a_line >> (4 * i)) & 0xF) | (((a_line >> (16 + i)) & 1) << 4));
+        if (v >= 3)
+            score += powf(3.0f, (float)(v - 2));
+    }
+    return score;
+}
+
+static struct RankScores
+{
+    RankScores()
+    {
+        for (uint32_t line = 0; line < LINE_COUNT; ++line)
+        {
+            scores[line] = CalculateRankScore(line);
+        }
+    }
+
+    float Get(const PackedBoard& a_board) const
+    {
+        float score = 0.0f;
+        for (uint8_t row = 0; row < PackedBoard::EXTENT; ++row)
+        {
+            const uint32_t line = a_board.GetRow(row);
+            score += (line >> 16) == 0 ? scores[line] : CalculateRankScore(line);
+        }
+        return score;
+    }
+
+    enum
+    {
+        LINE_COUNT = 1 << 16
+    };
+    float scores[LINE_COUNT];
+} g_rankScores;
+
+bool IsLittleEndian()
+{
+    const uint32_t one = 1;
+    uint8_t first;
+    memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+} // namespace
+
+NTupleNetwork::NTupleNetwork()
+    : m_weights((size_t)TUPLE_COUNT * TUPLE_ENTRIES, 0.0f)
+{
+}
+
+float NTupleNetwork::Reward(const PackedBoard& a_board, const PackedBoard& a_afterstate)
+{
+    return g_rankScores.Get(a_afterstate) - g_rankScores.Get(a_board);
+}
+
+// the tuples of all 8 orientations of a board, each as the 16 bit index into its table
+void NTupleNetwork::CalculateIndices(const PackedBoard& a_board, uint32_t* out_indices)
+{
+    const PackedBoard base(SaturatedNibbles(a_board), 0);
+    for (uint8_t s = 0; s < SYMMETRIES; ++s)
+    {
+        const uint64_t x = base.Transformed(s).lo;
+        uint32_t* out    = out_indices + s * TUPLE_COUNT;
+
+        out[0] = (uint32_t)(x & 0xFFFF);                                // outer row: 0 1 2 3
+        out[1] = (uint32_t)((x >> 16) & 0xFFFF);                        // inner row: 4 5 6 7
+        out[2] = (uint32_t)((x & 0xFF) | ((x >> 8) & 0xFF00));          // corner square: 0 1 4 5
+        out[3] = (uint32_t)(((x >> 4) & 0xFF) | ((x >> 12) & 0xFF00));  // edge square: 1 2 5 6
+        out[4] = (uint32_t)(((x >> 20) & 0xFF) | ((x >> 28) & 0xFF00)); // center square: 5 6 9 10
+    }
+}
+
+float NTupleNetwork::Evaluate(const PackedBoard& a_afterstate) const
+{
+    uint32_t indices[FEATURE_COUNT];
+    CalculateIndices(a_afterstate, indices);
+    const float* weights = m_weights.data();
+    float value          = 0.0f;
+    for (uint8_t i = 0; i < FEATURE_COUNT; ++i)
+    {
+        value += weights[(i % TUPLE_COUNT) * TUPLE_ENTRIES + indices[i]];
+    }
+    return value;
+}
+
+float NTupleNetwork::EvaluateState(const PackedBoard& a_board) const
+{
+    float best = 0.0f; // game over: nothing left to score
+    bool any   = false;
+    for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+    {
+        PackedBoard afterstate = a_board;
+        if (!afterstate.Move((EDirections)dir))
+        {
+            continue;
+        }
+        const float value = Reward(a_board, afterstate) + Evaluate(afterstate);
+        if (!any || value > best)
+        {
+            best = value;
+            any  = true;
+        }
+    }
+    return best;
+}
+
+void NTupleNetwork::Update(const PackedBoard& a_afterstate, float a_delta)
+{
+    uint32_t indices[FEATURE_COUNT];
+    CalculateIndices(a_afterstate, indices);
+    float* weights = m_weights.data();
+    for (uint8_t i = 0; i < FEATURE_COUNT; ++i)
+    {
+        weights[(i % TUPLE_COUNT) * TUPLE_ENTRIES + indices[i]] += a_delta;
+    }
+}
+
+NTupleNetwork::Learner::Learner(const NTupleNetwork& a_network)
+    : m_network(&a_network)
+    , m_deltas(a_network.m_weights.size(), 0.0f)
+{
+}
+
+float NTupleNetwork::Learner::Evaluate(const PackedBoard& a_afterstate) const
+{
+    uint32_t indices[FEATURE_COUNT];
+    CalculateIndices(a_afterstate, indices);
+    const float* weights = m_network->m_weights.data();
+    const float* deltas  = m_deltas.data();
+    float value          = 0.0f;
+    for (uint8_t i = 0; i < FEATURE_COUNT; ++i)
+    {
+        const uint32_t index = (i % TUPLE_COUNT) * TUPLE_ENTRIES + indices[i];
+        value += weights[index] + deltas[index];
+    }
+    return value;
+}
+
+void NTupleNetwork::Learner::Update(const PackedBoard& a_afterstate, float a_delta)
+{
+    uint32_t indices[FEATURE_COUNT];
+    CalculateIndices(a_afterstate, indices);
+    float* deltas = m_deltas.data();
+    for (uint8_t i = 0; i < FEATURE_COUNT; ++i)
+    {
+        const uint32_t index = (i % TUPLE_COUNT) * TUPLE_ENTRIES + indices[i];
+        if (deltas[index] == 0.0f)
+            m_touched.push_back(index);
+        deltas[index] += a_delta;
+    }
+}
+
+void NTupleNetwork::Learner::Apply(NTupleNetwork& out_network)
+{
+    float* weights = out_network.m_weights.data();
+    for (uint32_t index : m_touched)
+    {
+        weights[index] += m_deltas[index];
+        m_deltas[index] = 0.0f;
+    }
+    m_touched.clear();
+}
+
+bool NTupleNetwork::Load(const char* a_path)
+{
+    FILE* file = fopen(a_path, "rb");
+    if (!file)
+    {
+        return false;
+    }
+    char magic[4];
+    uint32_t header[3];
+    bool ok = fread(magic, sizeof(magic), 1, file) == 1 && memcmp(magic, g_magic, sizeof(magic)) == 0 &&
+              fread(header, sizeof(header), 1, file) == 1 && IsLittleEndian() &&
+              header[0] == g_formatVersion && header[1] == TUPLE_COUNT && header[2] == TUPLE_ENTRIES;
+    std::vector<float> weights(m_weights.size());
+    ok = ok && fread(weights.data(), sizeof(float), weights.size(), file) == weights.size();
+    fclose(file);
+    if (ok)
+        m_weights.swap(weights);
+    return ok;
+}
+
+bool NTupleNetwork::Save(const char* a_path) const
+{
+    if (!IsLittleEndian())
+    {
+        return false;
+    }
+    FILE* file = fopen(a_path, "wb");
+    if (!file)
+    {
+        return false;
+    }
+    const uint32_t header[3] = { g_formatVersion, TUPLE_COUNT, TUPLE_ENTRIES };
+
+    bool ok = fwrite(g_magic, sizeof(g_magic), 1, file) == 1 &&
+              fwrite(header, sizeof(header), 1, file) == 1 &&
+              fwrite(m_weights.data(), sizeof(float), m_weights.size(), file) == m_weights.size();
+    ok &= fclose(file) == 0;
+    return ok;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <core/board.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// learned board evaluation: a sum of weights looked up by 4-tuples of cells (two kinds of rows and three kinds
+// of 2x2 squares), each tuple read in all 8 orientations of the board. tile values are indexed by their nibble,
+// tiles above 15 count as 15. every tuple owns one table of 65536 floats, indexed by its 4 nibbles exactly as
+// they sit in PackedBoard::lo, so a lookup is a shift and a mask away from the board.
+// weights are trained on afterstates (the board after a move, before the spawn) with TD(0), see tthrees_train.
+struct NTupleNetwork
+{
+    static constexpr uint8_t TUPLE_COUNT    = 5;
+    static constexpr uint8_t SYMMETRIES     = PackedBoard::SYMMETRY_COUNT;
+    static constexpr uint8_t FEATURE_COUNT  = TUPLE_COUNT * SYMMETRIES;
+    static constexpr uint32_t TUPLE_ENTRIES = 1 << 16;
+
+    NTupleNetwork();
+
+    // the reward the network learns to maximize: the gain in 3^(rank) tile score (the original game's scoring)
+    // merging a_board into a_afterstate earned. PackedBoard::Score doubles per rank, so merges never change it.
+    static float Reward(const PackedBoard& a_board, const PackedBoard& a_afterstate);
+
+    // expected reward still to come from an afterstate
+    float Evaluate(const PackedBoard& a_afterstate) const;
+    // expected reward still to come from a board about to move: the best move's reward plus its afterstate value
+    float EvaluateState(const PackedBoard& a_board) const;
+    // adds a_delta to every weight a_afterstate looks up
+    void Update(const PackedBoard& a_afterstate, float a_delta);
+
+    bool Load(const char* a_path);
+    bool Save(const char* a_path) const;
+
+    // learns from a network without writing to it: updates are kept aside, Evaluate sees the network plus them.
+    // several threads can each learn through their own Learner while none of them writes the network; Apply then
+    // adds the updates, with no thread reading it
+    struct Learner
+    {
+        explicit Learner(const NTupleNetwork& a_network);
+
+        float Evaluate(const PackedBoard& a_afterstate) const;
+        void Update(const PackedBoard& a_afterstate, float a_delta);
+        // adds the updates kept aside to out_network and forgets them
+        void Apply(NTupleNetwork& out_network);
+
+    private:
+        const NTupleNetwork* m_network;
+        std::vector<float> m_deltas;     // same layout as the weights
+        std::vector<uint32_t> m_touched; // weights with a delta, may repeat
+    };
+
+private:
+    static void CalculateIndices(const PackedBoard& a_board, uint32_t* out_indices);
+
+    std::vector<float> m_weights; // TUPLE_COUNT tables of TUPLE_ENTRIES
+};
@@ -0,0 +1,149 @@
+#include "transposition.h"
+
+#include <core/threes.h>
+#include <string.h>
+
+namespace
+{
+// one key per tile and nibble value plus one per tile for the fifth bit, so hashing never has to reassemble tiles
+static struct ZobristKeys
+{
+    ZobristKeys()
+    {
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        for (int i = 0; i < PackedBoard::SIZE; ++i)
+        {
+            for (int v = 0; v < 16; ++v)
+            {
+                tiles[i][v] = SplitMix64(state);
+            }
+            high[i] = SplitMix64(state);
+        }
+        for (int v = 0; v <= PackedBoard::MAX_VALUE; ++v)
+        {
+            next[v] = SplitMix64(state);
+        }
+        for (int d = 0; d < Threes::DeckState::INDEX_COUNT; ++d)
+        {
+            deck[d] = SplitMix64(state);
+        }
+    }
+
+    static uint64_t SplitMix64(uint64_t& a_state)
+    {
+        uint64_t z = (a_state += 0x9E3779B97F4A7C15ULL);
+        z          = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z          = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t tiles[PackedBoard::SIZE][16];
+    uint64_t high[PackedBoard::SIZE];
+    uint64_t next[PackedBoard::MAX_VALUE + 1];
+    uint64_t deck[Threes::DeckState::INDEX_COUNT];
+} g_zobrist;
+
+} // namespace
+
+TranspositionTable::TranspositionTable(size_t a_bytes)
+    : m_count(0)
+{
+    for (size_t n = 1; n * sizeof(Bucket) <= a_bytes; n <<= 1)
+    {
+        m_count = n;
+    }
+    if (m_count > 0)
+    {
+        m_buckets.reset(new Bucket[m_count]);
+    }
+    Clear();
+}
+
+uint64_t TranspositionTable::Hash(const PackedBoard& a_board, uint8_t a_next, uint8_t a_deck)
+{
+    uint64_t key = g_zobrist.next[a_next & PackedBoard::MAX_VALUE] ^ g_zobrist.deck[a_deck % Threes::DeckState::INDEX_COUNT];
+    uint64_t lo  = a_board.lo;
+    for (uint8_t i = 0; i < PackedBoard::SIZE; ++i, lo >>= 4)
+    {
+        key ^= g_zobrist.tiles[i][lo & 0xF];
+    }
+    if (a_board.hi != 0)
+    {
+        for (uint8_t i = 0; i < PackedBoard::SIZE; ++i)
+        {
+            if (a_board.hi & (1 << i))
+                key ^= g_zobrist.high[i];
+        }
+    }
+    return key;
+}
+
+// only entries of exactly the requested depth are used: the value of a node then stays a pure function
+// of board, next tile and depth, no matter which searches (or threads) filled the table.
+bool TranspositionTable::Probe(uint64_t a_key, uint8_t a_depth, float& out_value, EDirections& out_move) const
+{
+    if (m_count == 0)
+    {
+        return false;
+    }
+    const Bucket& bucket   = m_buckets[a_key & (m_count - 1)];
+    const Entry* entries[] = { &bucket.deepest, &bucket.recent };
+    for (const Entry* entry : entries)
+    {
+        const uint64_t data  = entry->data.load(std::memory_order_relaxed);
+        const uint64_t check = entry->check.load(std::memory_order_relaxed);
+        if ((check ^ data) == a_key && (uint8_t)(data >> 32) == a_depth)
+        {
+            const uint32_t bits = (uint32_t)data;
+            memcpy(&out_value, &bits, sizeof(out_value));
+            out_move = (EDirections)(uint8_t)(data >> 40);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::Store(uint64_t a_key, uint8_t a_depth, float a_value, EDirections a_move)
+{
+    if (m_count == 0)
+    {
+        return;
+    }
+    Bucket& bucket      = m_buckets[a_key & (m_count - 1)];
+    const uint64_t data = Pack(a_value, a_depth, a_move);
+    const uint64_t old  = bucket.deepest.data.load(std::memory_order_relaxed);
+    if (a_depth >= (uint8_t)(old >> 32))
+    {
+        // the displaced entry still gets a chance in the other slot
+        const uint64_t oldKey = bucket.deepest.check.load(std::memory_order_relaxed) ^ old;
+        if (oldKey != a_key)
+            Write(bucket.recent, oldKey, old);
+        Write(bucket.deepest, a_key, data);
+    }
+    else
+    {
+        Write(bucket.recent, a_key, data);
+    }
+}
+
+void TranspositionTable::Clear()
+{
+    for (size_t i = 0; i < m_count; ++i)
+    {
+        Write(m_buckets[i].deepest, 0, 0);
+        Write(m_buckets[i].recent, 0, 0);
+    }
+}
+
+uint64_t TranspositionTable::Pack(float a_value, uint8_t a_depth, EDirections a_move)
+{
+    uint32_t bits;
+    memcpy(&bits, &a_value, sizeof(bits));
+    return (uint64_t)bits | ((uint64_t)a_depth << 32) | ((uint64_t)(uint8_t)a_move << 40);
+}
+
+void TranspositionTable::Write(Entry& a_entry, uint64_t a_key, uint64_t a_data)
+{
+    a_entry.data.store(a_data, std::memory_order_relaxed);
+    a_entry.check.store(a_key ^ a_data, std::memory_order_relaxed);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <core/board.h>
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+// fixed size cache of searched max nodes, keyed by a zobrist hash of the 16 tiles, the next tile and the deck.
+// Expectimax hashes canonical boards, so the stored move is relative to the canonical orientation.
+// buckets hold two entries: one only replaced by deeper (or equally deep) searches, one always replaced.
+// the table is shared by all search threads without locks: every entry stores its key xor'ed with its
+// payload, so an entry torn by concurrent writers simply fails verification and counts as a miss.
+struct TranspositionTable
+{
+    // a_bytes is rounded down to a power of two number of buckets, 0 disables the table
+    explicit TranspositionTable(size_t a_bytes);
+
+    // a_deck is a Threes::DeckState::Index()
+    static uint64_t Hash(const PackedBoard& a_board, uint8_t a_next, uint8_t a_deck);
+
+    bool Probe(uint64_t a_key, uint8_t a_depth, float& out_value, EDirections& out_move) const;
+    void Store(uint64_t a_key, uint8_t a_depth, float a_value, EDirections a_move);
+    void Clear();
+
+    bool IsEnabled() const { return m_count > 0; }
+    size_t GetMemorySize() const { return m_count * sizeof(Bucket); }
+
+private:
+    struct Entry
+    {
+        std::atomic<uint64_t> check; // key ^ data
+        std::atomic<uint64_t> data;  // value bits (0..31), depth (32..39, 0 = unused), move (40..47)
+    };
+    struct Bucket
+    {
+        Entry deepest;
+        Entry recent;
+    };
+
+    static uint64_t Pack(float a_value, uint8_t a_depth, EDirections a_move);
+    static void Write(Entry& a_entry, uint64_t a_key, uint64_t a_data);
+
+    std::unique_ptr<Bucket[]> m_buckets;
+    size_t m_count;
+};
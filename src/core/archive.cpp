@@ -0,0 +1,353 @@
+#include "archive.h"
+
+#include <util/threadpool.h>
+
+#include <atomic>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+const char g_magic[4] = { 'T', 'T', 'R', 'A' };
+
+uint64_t ReadUInt(const uint8_t* a_bytes, int a_size)
+{
+    uint64_t value = 0;
+    for (int i = a_size - 1; i >= 0; --i)
+    {
+        value = (value << 8) | a_bytes[i];
+    }
+    return value;
+}
+
+void WriteUInt(uint8_t* out_bytes, uint64_t a_value, int a_size)
+{
+    for (int i = 0; i < a_size; ++i)
+    {
+        out_bytes[i] = (uint8_t)(a_value >> (8 * i));
+    }
+}
+
+bool Seek(FILE* a_file, uint64_t a_offset)
+{
+#if defined(_WIN32)
+    return _fseeki64(a_file, (__int64)a_offset, SEEK_SET) == 0;
+#else
+    return fseeko(a_file, (off_t)a_offset, SEEK_SET) == 0;
+#endif
+}
+
+} // namespace
+
+ReplayArchive::ReplayArchive()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_count(0)
+#if defined(_WIN32)
+    , m_file(nullptr)
+    , m_mapping(nullptr)
+#endif
+{
+}
+
+ReplayArchive::~ReplayArchive()
+{
+    Close();
+}
+
+bool ReplayArchive::Open(const char* a_path)
+{
+    Close();
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(a_path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER size;
+    HANDLE mapping   = GetFileSizeEx(file, &size) && size.QuadPart > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    const void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    m_file           = file;
+    m_mapping        = mapping;
+    if (!data)
+    {
+        Close();
+        return false;
+    }
+    m_data = (const uint8_t*)data;
+    m_size = (size_t)size.QuadPart;
+#else
+    const int file = open(a_path, O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (fstat(file, &info) == 0 && info.st_size > 0)
+        data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, file, 0);
+    // the mapping keeps the file open
+    close(file);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    m_data = (const uint8_t*)data;
+    m_size = (size_t)info.st_size;
+#endif
+
+    if (m_size < HEADER_SIZE + BLOCK_SIZE || memcmp(m_data, g_magic, sizeof(g_magic)) != 0 || ReadUInt(m_data + 4, 4) != VERSION)
+    {
+        Close();
+        return false;
+    }
+    // blocks are always appended, so a valid chain only goes forward. a block that is not full ends it
+    uint64_t offset = HEADER_SIZE;
+    while (offset != 0 && offset + BLOCK_SIZE <= m_size)
+    {
+        const uint8_t* block = m_data + offset;
+        const uint64_t next  = ReadUInt(block, 8);
+        const uint32_t used  = (uint32_t)ReadUInt(block + 8, 4);
+        if (used > BLOCK_CAPACITY)
+            break;
+        m_blocks.push_back(block);
+        m_count += used;
+        if (used < BLOCK_CAPACITY || next <= offset)
+            break;
+        offset = next;
+    }
+    return true;
+}
+
+void ReplayArchive::Close()
+{
+#if defined(_WIN32)
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping)
+        CloseHandle((HANDLE)m_mapping);
+    if (m_file)
+        CloseHandle((HANDLE)m_file);
+    m_file    = nullptr;
+    m_mapping = nullptr;
+#else
+    if (m_data)
+        munmap((void*)m_data, m_size);
+#endif
+    m_data  = nullptr;
+    m_size  = 0;
+    m_count = 0;
+    m_blocks.clear();
+}
+
+bool ReplayArchive::Get(uint64_t a_index, Replay& out_replay) const
+{
+    if (a_index >= m_count)
+    {
+        return false;
+    }
+    const uint8_t* block  = m_blocks[a_index / BLOCK_CAPACITY];
+    const uint64_t offset = ReadUInt(block + BLOCK_HEADER_SIZE + 8 * (a_index % BLOCK_CAPACITY), 8);
+    return offset < m_size && out_replay.Deserialize(m_data + offset, m_size - (size_t)offset);
+}
+
+uint64_t ReplayArchive::ParallelScan(ThreadPool& a_pool, const ScanTask& a_task) const
+{
+    std::atomic<uint64_t> damaged(0);
+    a_pool.ParallelFor(m_blocks.size(), [&](size_t a_block, int a_thread) {
+        Replay replay;
+        const uint64_t first = (uint64_t)a_block * BLOCK_CAPACITY;
+        const uint64_t last  = first + BLOCK_CAPACITY < m_count ? first + BLOCK_CAPACITY : m_count;
+        for (uint64_t i = first; i < last; ++i)
+        {
+            if (Get(i, replay))
+                a_task(i, replay, a_thread);
+            else
+                ++damaged;
+        }
+    });
+    return damaged.load();
+}
+
+ReplayArchiveWriter::ReplayArchiveWriter()
+    : m_file(nullptr)
+    , m_end(0)
+    , m_blockOffset(0)
+    , m_count(0)
+    , m_atEnd(false)
+{
+}
+
+ReplayArchiveWriter::~ReplayArchiveWriter()
+{
+    Close();
+}
+
+bool ReplayArchiveWriter::Open(const char* a_path)
+{
+    Close();
+    m_count = 0;
+    m_entries.clear();
+    FILE* file = fopen(a_path, "r+b");
+    if (!file)
+    {
+        file = fopen(a_path, "w+b");
+        if (!file || !Create(file))
+        {
+            if (file)
+                fclose(file);
+            return false;
+        }
+    }
+    else if (!Load(file))
+    {
+        fclose(file);
+        return false;
+    }
+    m_file  = file;
+    m_atEnd = true;
+    return true;
+}
+
+bool ReplayArchiveWriter::Append(const Replay& a_replay)
+{
+    if (!m_file)
+    {
+        return false;
+    }
+    if (m_entries.size() == ReplayArchive::BLOCK_CAPACITY)
+    {
+        // the new block goes in first, the full one only links to it once it exists
+        const std::vector<uint8_t> block(ReplayArchive::BLOCK_SIZE, 0);
+        uint8_t next[8];
+        WriteUInt(next, m_end, 8);
+        if (!WriteBlockIndex() || !WriteAt(m_end, block.data(), block.size()) || !WriteAt(m_blockOffset, next, sizeof(next)))
+        {
+            return false;
+        }
+        m_blockOffset = m_end;
+        m_end += ReplayArchive::BLOCK_SIZE;
+        m_entries.clear();
+    }
+    m_buffer.resize(a_replay.GetSerializedSize());
+    a_replay.Serialize(m_buffer.data());
+    if (!m_atEnd && !Seek(m_file, m_end))
+    {
+        return false;
+    }
+    if (fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) != m_buffer.size())
+    {
+        m_atEnd = false;
+        return false;
+    }
+    m_atEnd = true;
+    m_entries.push_back(m_end);
+    m_end += m_buffer.size();
+    ++m_count;
+    return true;
+}
+
+bool ReplayArchiveWriter::Flush()
+{
+    return m_file && WriteBlockIndex() && fflush(m_file) == 0;
+}
+
+bool ReplayArchiveWriter::Close()
+{
+    if (!m_file)
+    {
+        return true;
+    }
+    bool ok = Flush();
+    ok &= fclose(m_file) == 0;
+    m_file = nullptr;
+    return ok;
+}
+
+bool ReplayArchiveWriter::Create(FILE* a_file)
+{
+    uint8_t header[ReplayArchive::HEADER_SIZE];
+    memcpy(header, g_magic, sizeof(g_magic));
+    WriteUInt(header + 4, ReplayArchive::VERSION, 4);
+    const std::vector<uint8_t> block(ReplayArchive::BLOCK_SIZE, 0);
+    if (fwrite(header, 1, sizeof(header), a_file) != sizeof(header) || fwrite(block.data(), 1, block.size(), a_file) != block.size())
+    {
+        return false;
+    }
+    m_blockOffset = ReplayArchive::HEADER_SIZE;
+    m_end         = ReplayArchive::HEADER_SIZE + ReplayArchive::BLOCK_SIZE;
+    return true;
+}
+
+bool ReplayArchiveWriter::Load(FILE* a_file)
+{
+    uint8_t header[ReplayArchive::HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), a_file) != sizeof(header) || memcmp(header, g_magic, sizeof(g_magic)) != 0 ||
+        ReadUInt(header + 4, 4) != ReplayArchive::VERSION)
+    {
+        return false;
+    }
+    // the last block is the first one that is not full, its entries are kept to be rewritten with every flush
+    std::vector<uint8_t> block(ReplayArchive::BLOCK_SIZE);
+    uint64_t offset = ReplayArchive::HEADER_SIZE;
+    while (true)
+    {
+        if (!Seek(a_file, offset) || fread(block.data(), 1, block.size(), a_file) != block.size())
+        {
+            return false;
+        }
+        const uint64_t next = ReadUInt(block.data(), 8);
+        const uint32_t used = (uint32_t)ReadUInt(block.data() + 8, 4);
+        if (used > ReplayArchive::BLOCK_CAPACITY)
+        {
+            return false;
+        }
+        m_count += used;
+        if (used < ReplayArchive::BLOCK_CAPACITY || next <= offset)
+        {
+            m_blockOffset = offset;
+            for (uint32_t i = 0; i < used; ++i)
+            {
+                m_entries.push_back(ReadUInt(block.data() + ReplayArchive::BLOCK_HEADER_SIZE + 8 * i, 8));
+            }
+            break;
+        }
+        offset = next;
+    }
+    if (fseek(a_file, 0, SEEK_END) != 0)
+    {
+        return false;
+    }
+#if defined(_WIN32)
+    m_end = (uint64_t)_ftelli64(a_file);
+#else
+    m_end = (uint64_t)ftello(a_file);
+#endif
+    return true;
+}
+
+bool ReplayArchiveWriter::WriteBlockIndex()
+{
+    std::vector<uint8_t> index(4 + 4 + 8 * m_entries.size(), 0);
+    WriteUInt(index.data(), m_entries.size(), 4);
+    for (size_t i = 0; i < m_entries.size(); ++i)
+    {
+        WriteUInt(index.data() + 8 + 8 * i, m_entries[i], 8);
+    }
+    return WriteAt(m_blockOffset + 8, index.data(), index.size());
+}
+
+bool ReplayArchiveWriter::WriteAt(uint64_t a_offset, const void* a_data, size_t a_size)
+{
+    m_atEnd = a_offset + a_size == m_end;
+    return Seek(m_file, a_offset) && fwrite(a_data, 1, a_size, m_file) == a_size;
+}
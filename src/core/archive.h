@@ -0,0 +1,83 @@
+#pragma once
+
+#include <core/replay.h>
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+struct ThreadPool;
+
+// any number of replays in one file, so analysis does not open and parse a file per game.
+// layout, little endian: "TTRA", uint32 version, then a chain of index blocks. a block is the offset of the next block
+// (0 for the last one), the number of used entries (uint32), 4 reserved bytes and BLOCK_CAPACITY record offsets (uint64).
+// records are serialized Replays behind the block that lists them. appending writes records at the end of the file and
+// entries into the last block, a full block gets its successor appended - nothing that is written ever moves.
+// this is the read only view, through a memory mapping: game N takes two lookups, whatever comes before it.
+struct ReplayArchive
+{
+    static constexpr uint32_t VERSION         = 1;
+    static constexpr size_t HEADER_SIZE       = 8;
+    static constexpr uint32_t BLOCK_CAPACITY  = 4096;
+    static constexpr size_t BLOCK_HEADER_SIZE = 16;
+    static constexpr size_t BLOCK_SIZE        = BLOCK_HEADER_SIZE + 8 * (size_t)BLOCK_CAPACITY;
+
+    typedef std::function<void(uint64_t a_index, const Replay& a_replay, int a_thread)> ScanTask;
+
+    ReplayArchive();
+    ~ReplayArchive();
+    ReplayArchive(const ReplayArchive&)            = delete;
+    ReplayArchive& operator=(const ReplayArchive&) = delete;
+
+    // sees the games a writer closed or flushed before
+    bool Open(const char* a_path);
+    void Close();
+
+    uint64_t GetCount() const { return m_count; }
+    // false if the record of game a_index is damaged
+    bool Get(uint64_t a_index, Replay& out_replay) const;
+    // runs a_task for every game, one index block per pool task. damaged games are skipped and counted
+    uint64_t ParallelScan(ThreadPool& a_pool, const ScanTask& a_task) const;
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    std::vector<const uint8_t*> m_blocks;
+    uint64_t m_count;
+#if defined(_WIN32)
+    void* m_file;
+    void* m_mapping;
+#endif
+};
+
+// appends games to an archive, creating the file if there is none
+struct ReplayArchiveWriter
+{
+    ReplayArchiveWriter();
+    ~ReplayArchiveWriter();
+    ReplayArchiveWriter(const ReplayArchiveWriter&)            = delete;
+    ReplayArchiveWriter& operator=(const ReplayArchiveWriter&) = delete;
+
+    bool Open(const char* a_path);
+    bool Append(const Replay& a_replay);
+    // writes the index of the last block, the games appended so far are visible to readers from then on
+    bool Flush();
+    bool Close();
+
+    uint64_t GetCount() const { return m_count; }
+
+private:
+    bool Create(FILE* a_file);
+    bool Load(FILE* a_file);
+    bool WriteBlockIndex();
+    bool WriteAt(uint64_t a_offset, const void* a_data, size_t a_size);
+
+    FILE* m_file;
+    uint64_t m_end;
+    uint64_t m_blockOffset;          // the last block, the only one with free entries
+    std::vector<uint64_t> m_entries; // of the last block
+    uint64_t m_count;
+    bool m_atEnd; // the file position is m_end, records are written without a seek
+    std::vector<uint8_t> m_buffer;
+};
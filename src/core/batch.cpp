@@ -0,0 +1,256 @@
+#include "batch.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define THREES_BATCH_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define THREES_BATCH_SSE2
+#endif
+
+namespace
+{
+// every lane type offers the same handful of byte wise operations, masks being 0xFF (true) or 0x00 (false),
+// so the kernels below are written once. tiles never exceed 31, so signed compares are fine.
+struct ScalarLanes
+{
+    typedef uint8_t V;
+    static constexpr size_t WIDTH = 1;
+
+    static V Load(const uint8_t* a_src) { return *a_src; }
+    static void Store(uint8_t* a_dst, V a_v) { *a_dst = a_v; }
+    static V Set1(uint8_t a_x) { return a_x; }
+    static V Eq(V a_a, V a_b) { return a_a == a_b ? 0xFF : 0x00; }
+    static V Gt(V a_a, V a_b) { return a_a > a_b ? 0xFF : 0x00; }
+    static V And(V a_a, V a_b) { return a_a & a_b; }
+    static V Or(V a_a, V a_b) { return a_a | a_b; }
+    static V AndNot(V a_a, V a_b) { return (V)(~a_a & a_b); }
+    static V Add(V a_a, V a_b) { return (V)(a_a + a_b); }
+    // 16 bit masks from their low and high bytes
+    static void StoreMask16(uint16_t* a_dst, V a_lo, V a_hi) { *a_dst = (uint16_t)(a_lo | (a_hi << 8)); }
+};
+
+#if defined(THREES_BATCH_AVX2)
+struct SimdLanes
+{
+    typedef __m256i V;
+    static constexpr size_t WIDTH = 32;
+
+    static V Load(const uint8_t* a_src) { return _mm256_loadu_si256((const __m256i*)a_src); }
+    static void Store(uint8_t* a_dst, V a_v) { _mm256_storeu_si256((__m256i*)a_dst, a_v); }
+    static V Set1(uint8_t a_x) { return _mm256_set1_epi8((char)a_x); }
+    static V Eq(V a_a, V a_b) { return _mm256_cmpeq_epi8(a_a, a_b); }
+    static V Gt(V a_a, V a_b) { return _mm256_cmpgt_epi8(a_a, a_b); }
+    static V And(V a_a, V a_b) { return _mm256_and_si256(a_a, a_b); }
+    static V Or(V a_a, V a_b) { return _mm256_or_si256(a_a, a_b); }
+    static V AndNot(V a_a, V a_b) { return _mm256_andnot_si256(a_a, a_b); }
+    static V Add(V a_a, V a_b) { return _mm256_add_epi8(a_a, a_b); }
+    static void StoreMask16(uint16_t* a_dst, V a_lo, V a_hi)
+    {
+        // unpack works within 128 bit halves, so put the 64 bit quarters in 0 2 1 3 order first
+        const V lo = _mm256_permute4x64_epi64(a_lo, 0xD8);
+        const V hi = _mm256_permute4x64_epi64(a_hi, 0xD8);
+        _mm256_storeu_si256((__m256i*)a_dst, _mm256_unpacklo_epi8(lo, hi));
+        _mm256_storeu_si256((__m256i*)(a_dst + 16), _mm256_unpackhi_epi8(lo, hi));
+    }
+};
+#elif defined(THREES_BATCH_SSE2)
+struct SimdLanes
+{
+    typedef __m128i V;
+    static constexpr size_t WIDTH = 16;
+
+    static V Load(const uint8_t* a_src) { return _mm_loadu_si128((const __m128i*)a_src); }
+    static void Store(uint8_t* a_dst, V a_v) { _mm_storeu_si128((__m128i*)a_dst, a_v); }
+    static V Set1(uint8_t a_x) { return _mm_set1_epi8((char)a_x); }
+    static V Eq(V a_a, V a_b) { return _mm_cmpeq_epi8(a_a, a_b); }
+    static V Gt(V a_a, V a_b) { return _mm_cmpgt_epi8(a_a, a_b); }
+    static V And(V a_a, V a_b) { return _mm_and_si128(a_a, a_b); }
+    static V Or(V a_a, V a_b) { return _mm_or_si128(a_a, a_b); }
+    static V AndNot(V a_a, V a_b) { return _mm_andnot_si128(a_a, a_b); }
+    static V Add(V a_a, V a_b) { return _mm_add_epi8(a_a, a_b); }
+    static void StoreMask16(uint16_t* a_dst, V a_lo, V a_hi)
+    {
+        _mm_storeu_si128((__m128i*)a_dst, _mm_unpacklo_epi8(a_lo, a_hi));
+        _mm_storeu_si128((__m128i*)(a_dst + 8), _mm_unpackhi_epi8(a_lo, a_hi));
+    }
+};
+#else
+typedef ScalarLanes SimdLanes;
+#endif
+
+// cell index of line position i (0 being the edge tiles are pushed towards) for every direction and line
+struct LineCells
+{
+    LineCells()
+    {
+        const uint8_t n = PackedBoard::EXTENT;
+        for (uint8_t line = 0; line < n; ++line)
+        {
+            for (uint8_t i = 0; i < n; ++i)
+            {
+                cells[(int)EDirections::Left][line][i]  = line * n + i;
+                cells[(int)EDirections::Right][line][i] = line * n + (n - 1 - i);
+                cells[(int)EDirections::Up][line][i]    = i * n + line;
+                cells[(int)EDirections::Down][line][i]  = (n - 1 - i) * n + line;
+            }
+        }
+    }
+
+    uint8_t cells[(int)EDirections::COUNT][PackedBoard::EXTENT][PackedBoard::EXTENT];
+};
+const LineCells g_lineCells;
+
+template <typename L>
+struct Kernels
+{
+    typedef typename L::V V;
+
+    // can a_from move onto a_to (see CalculateMergeResult in board.cpp). a sum of 3 with an empty cell
+    // is a plain move anyway, so it does not need to be told apart from 1 + 2.
+    static V CanMerge(V a_to, V a_from, V a_zero, V a_two, V a_three)
+    {
+        const V toEmpty = L::Eq(a_to, a_zero);
+        const V small   = L::Eq(L::Add(a_to, a_from), a_three);
+        const V equal   = L::And(L::Eq(a_to, a_from), L::Gt(a_to, a_two));
+        return L::AndNot(L::Eq(a_from, a_zero), L::Or(toEmpty, L::Or(small, equal)));
+    }
+    // the result of a merge CanMerge allowed: a move into an empty cell, 1 + 2 or two equal tiles
+    static V Merge(V a_to, V a_from, V a_zero, V a_three)
+    {
+        const V grown = L::Add(a_to, L::Set1(1));
+        const V other = Select(L::Eq(a_to, a_from), grown, a_three);
+        return Select(L::Eq(a_to, a_zero), a_from, other);
+    }
+    static V Select(V a_mask, V a_a, V a_b) { return L::Or(L::And(a_mask, a_a), L::AndNot(a_mask, a_b)); }
+
+    // moves boards [a_begin, a_end) (a multiple of WIDTH apart), the planes being a_stride bytes apart
+    static void Move(uint8_t* a_cells, size_t a_stride, size_t a_begin, size_t a_end, EDirections a_dir, uint16_t* out_moved, uint8_t* out_changed)
+    {
+        const V zero  = L::Set1(0);
+        const V two   = L::Set1(2);
+        const V three = L::Set1(3);
+        for (size_t b = a_begin; b < a_end; b += L::WIDTH)
+        {
+            V movedLo = zero;
+            V movedHi = zero;
+            for (uint8_t line = 0; line < PackedBoard::EXTENT; ++line)
+            {
+                const uint8_t* cells = g_lineCells.cells[(int)a_dir][line];
+                uint8_t* p[PackedBoard::EXTENT];
+                V v[PackedBoard::EXTENT];
+                for (uint8_t i = 0; i < PackedBoard::EXTENT; ++i)
+                {
+                    p[i] = a_cells + cells[i] * a_stride + b;
+                    v[i] = L::Load(p[i]);
+                }
+                // once a position shifted, everything behind it shifts as well
+                const V s1 = CanMerge(v[0], v[1], zero, two, three);
+                const V s2 = L::Or(s1, CanMerge(v[1], v[2], zero, two, three));
+                const V s3 = L::Or(s2, CanMerge(v[2], v[3], zero, two, three));
+                L::Store(p[0], Select(s1, Merge(v[0], v[1], zero, three), v[0]));
+                L::Store(p[1], Select(s1, v[2], Select(s2, Merge(v[1], v[2], zero, three), v[1])));
+                L::Store(p[2], Select(s2, v[3], Select(s3, Merge(v[2], v[3], zero, three), v[2])));
+                L::Store(p[3], L::AndNot(s3, v[3]));
+
+                // a shifted empty cell did not move
+                const V shifted[] = { s1, s2, s3 };
+                for (uint8_t i = 1; i < PackedBoard::EXTENT; ++i)
+                {
+                    const V moved = L::AndNot(L::Eq(v[i], zero), shifted[i - 1]);
+                    const V bit   = L::And(moved, L::Set1((uint8_t)(1 << (cells[i] & 7))));
+                    if (cells[i] < 8)
+                        movedLo = L::Or(movedLo, bit);
+                    else
+                        movedHi = L::Or(movedHi, bit);
+                }
+            }
+            if (out_moved)
+                L::StoreMask16(out_moved + b, movedLo, movedHi);
+            if (out_changed)
+                L::Store(out_changed + b, L::AndNot(L::Eq(L::Or(movedLo, movedHi), zero), L::Set1(1)));
+        }
+    }
+
+    static void CalculateGameOver(const uint8_t* a_cells, size_t a_stride, size_t a_begin, size_t a_end, uint8_t* out_gameOver)
+    {
+        const V zero    = L::Set1(0);
+        const V two     = L::Set1(2);
+        const V three   = L::Set1(3);
+        const uint8_t n = PackedBoard::EXTENT;
+        for (size_t b = a_begin; b < a_end; b += L::WIDTH)
+        {
+            V v[PackedBoard::SIZE];
+            V alive = zero;
+            for (uint8_t c = 0; c < PackedBoard::SIZE; ++c)
+            {
+                v[c]  = L::Load(a_cells + c * a_stride + b);
+                alive = L::Or(alive, L::Eq(v[c], zero));
+            }
+            // without empty cells only neighbours adding up to 3 or equal tiles >= 3 can still merge
+            for (uint8_t y = 0; y < n; ++y)
+            {
+                for (uint8_t x = 0; x < n; ++x)
+                {
+                    const V a = v[y * n + x];
+                    if (x + 1 < n)
+                    {
+                        const V r = v[y * n + x + 1];
+                        alive     = L::Or(alive, L::Or(L::Eq(L::Add(a, r), three), L::And(L::Eq(a, r), L::Gt(a, two))));
+                    }
+                    if (y + 1 < n)
+                    {
+                        const V d = v[(y + 1) * n + x];
+                        alive     = L::Or(alive, L::Or(L::Eq(L::Add(a, d), three), L::And(L::Eq(a, d), L::Gt(a, two))));
+                    }
+                }
+            }
+            L::Store(out_gameOver + b, L::AndNot(alive, L::Set1(1)));
+        }
+    }
+};
+
+} // namespace
+
+const size_t BoardBatch::LANES = SimdLanes::WIDTH;
+#if defined(THREES_BATCH_AVX2)
+const char* const BoardBatch::KERNEL = "avx2";
+#elif defined(THREES_BATCH_SSE2)
+const char* const BoardBatch::KERNEL = "sse2";
+#else
+const char* const BoardBatch::KERNEL = "scalar";
+#endif
+
+BoardBatch::BoardBatch(size_t a_count)
+    : m_count((a_count + SimdLanes::WIDTH - 1) / SimdLanes::WIDTH * SimdLanes::WIDTH)
+    , m_cells(m_count * PackedBoard::SIZE, 0)
+{
+}
+
+PackedBoard BoardBatch::GetBoard(size_t a_board) const
+{
+    PackedBoard board;
+    for (uint8_t i = 0; i < PackedBoard::SIZE; ++i)
+    {
+        board.Set(i, Get(a_board, i));
+    }
+    return board;
+}
+
+void BoardBatch::SetBoard(size_t a_board, const PackedBoard& a_packed)
+{
+    for (uint8_t i = 0; i < PackedBoard::SIZE; ++i)
+    {
+        Set(a_board, i, a_packed.Get(i));
+    }
+}
+
+void BoardBatch::Move(EDirections a_dir, uint16_t* out_moved, uint8_t* out_changed)
+{
+    Kernels<SimdLanes>::Move(m_cells.data(), m_count, 0, m_count, a_dir, out_moved, out_changed);
+}
+
+void BoardBatch::CalculateGameOver(uint8_t* out_gameOver) const
+{
+    Kernels<SimdLanes>::CalculateGameOver(m_cells.data(), m_count, 0, m_count, out_gameOver);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <core/board.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// many boards in structure of arrays layout: one byte plane per cell, cell c of board b at plane c, column b.
+// moves are applied to every board at once, LANES boards per instruction (AVX2 if the build enables it,
+// otherwise SSE2, otherwise plain bytes). spawning stays with the caller, see Threes for the rules.
+struct BoardBatch
+{
+    static const size_t LANES;       // boards per kernel step
+    static const char* const KERNEL; // "avx2", "sse2" or "scalar"
+
+    // the board count is rounded up to a multiple of LANES, padding boards are empty
+    explicit BoardBatch(size_t a_count);
+
+    size_t GetCount() const { return m_count; }
+
+    inline uint8_t Get(size_t a_board, uint8_t a_index) const { return m_cells[a_index * m_count + a_board]; }
+    inline void Set(size_t a_board, uint8_t a_index, uint8_t a_value) { m_cells[a_index * m_count + a_board] = a_value; }
+    PackedBoard GetBoard(size_t a_board) const;
+    void SetBoard(size_t a_board, const PackedBoard& a_packed);
+
+    // same as PackedBoard::Move on every board. optional outputs, one entry per board:
+    // out_moved the mask of moved source tiles, out_changed 1 if the board changed at all.
+    void Move(EDirections a_dir, uint16_t* out_moved = nullptr, uint8_t* out_changed = nullptr);
+    // same as PackedBoard::IsGameOver for every board, 1 if over
+    void CalculateGameOver(uint8_t* out_gameOver) const;
+
+private:
+    size_t m_count;
+    std::vector<uint8_t> m_cells;
+};
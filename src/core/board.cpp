@@ -0,0 +1,405 @@
+#include "board.h"
+
+namespace
+{
+// btw, formula for the tile values: f(i) = floor(2^i - 2^(i-2))
+//  => let's bake em in!
+const uint32_t g_scores[PackedBoard::MAX_VALUE + 1] = {
+           0,
+           1,
+           2,
+           3,
+           6,
+          12,
+          24,
+          48,
+          96,
+         192,
+         384,
+         768,
+        1536,
+        3072,
+        6144,
+       12288,
+       24576,
+       49152,
+       98304,
+      196608,
+      393216,
+      786432,
+     1572864,
+     3145728,
+     6291456,
+     1582912,
+    25165824,
+    50331648,
+};
+
+uint64_t TransposeLo(uint64_t a_x)
+{
+    const uint64_t a1 = a_x & 0xF0F00F0FF0F00F0FULL;
+    const uint64_t a2 = a_x & 0x0000F0F00000F0F0ULL;
+    const uint64_t a3 = a_x & 0x0F0F00000F0F0000ULL;
+    const uint64_t a  = a1 | (a2 << 12) | (a3 >> 12);
+    const uint64_t b1 = a & 0xFF00FF0000FF00FFULL;
+    const uint64_t b2 = a & 0x00FF00FF00000000ULL;
+    const uint64_t b3 = a & 0x00000000FF00FF00ULL;
+    return b1 | (b2 >> 24) | (b3 << 24);
+}
+
+uint16_t TransposeHi(uint16_t a_x)
+{
+    const uint16_t a = (uint16_t)((a_x & 0xA5A5) | ((a_x & 0x0A0A) << 3) | ((a_x & 0x5050) >> 3));
+    return (uint16_t)((a & 0xCC33) | ((a & 0x00CC) << 6) | ((a & 0x3300) >> 6));
+}
+
+// reverses the tiles of every row
+uint64_t MirrorLo(uint64_t a_x)
+{
+    return ((a_x & 0x000F000F000F000FULL) << 12) | ((a_x & 0x00F000F000F000F0ULL) << 4) | ((a_x >> 4) & 0x00F000F000F000F0ULL) | ((a_x >> 12) & 0x000F000F000F000FULL);
+}
+
+uint16_t MirrorHi(uint16_t a_x)
+{
+    return (uint16_t)(((a_x & 0x1111) << 3) | ((a_x & 0x2222) << 1) | ((a_x >> 1) & 0x2222) | ((a_x >> 3) & 0x1111));
+}
+
+// reverses the order of the rows
+uint64_t FlipLo(uint64_t a_x)
+{
+    return (a_x << 48) | ((a_x & 0xFFFF0000ULL) << 16) | ((a_x >> 16) & 0xFFFF0000ULL) | (a_x >> 48);
+}
+
+uint16_t FlipHi(uint16_t a_x)
+{
+    return (uint16_t)((a_x << 12) | ((a_x & 0xF0) << 4) | ((a_x >> 4) & 0xF0) | (a_x >> 12));
+}
+
+bool IsLess(const PackedBoard& a_lhs, const PackedBoard& a_rhs)
+{
+    return a_lhs.lo != a_rhs.lo ? a_lhs.lo < a_rhs.lo : a_lhs.hi < a_rhs.hi;
+}
+
+uint8_t ReverseBits4(uint8_t a_x)
+{
+    return (uint8_t)(((a_x & 1) << 3) | ((a_x & 2) << 1) | ((a_x >> 1) & 2) | ((a_x >> 3) & 1));
+}
+
+uint32_t ReverseLine(uint32_t a_line)
+{
+    const uint32_t n = a_line & 0xFFFF;
+    const uint32_t r = ((n & 0xF) << 12) | ((n & 0xF0) << 4) | ((n >> 4) & 0xF0) | (n >> 12);
+    return r | ((uint32_t)ReverseBits4((uint8_t)(a_line >> 16)) << 16);
+}
+
+uint8_t CalculateMergeResult(uint8_t a_to, uint8_t a_from)
+{
+    if ((a_from == 1 && a_to == 2) || (a_from == 2 && a_to == 1)) // combine small numbers
+        return 3;
+    if (a_from != 0 && a_to == 0) // move to empty field
+        return a_from;
+    if (a_from >= 3 && a_from == a_to) // combine non-small equal numbers
+        return a_from + 1;
+    return 0;
+}
+
+// a line is the 20 bit concatenation of 4 nibbles (position i at bits 4i..4i+3) and their 4 fifth bits (bits 16..19),
+// position 0 being the edge the tiles are pushed towards (see PackedBoard::GetRow).
+// returns the resulting line in the low 20 bits and the mask of moved positions in bits 20..23.
+// once a tile moved, every tile behind it follows (as the tile in front of it is empty now).
+uint32_t MoveLine(uint32_t a_line)
+{
+    uint8_t v[PackedBoard::EXTENT];
+    for (int i = 0; i < PackedBoard::EXTENT; ++i)
+    {
+        v[i] = (uint8_t)(((a_line >> (4 * i)) & 0xF) | (((a_line >> (16 + i)) & 1) << 4));
+    }
+    uint32_t moved = 0;
+    for (int i = 1; i < PackedBoard::EXTENT; ++i)
+    {
+        const uint8_t result = CalculateMergeResult(v[i - 1], v[i]);
+        if (result > 0)
+        {
+            v[i - 1] = result;
+            v[i]     = 0;
+            moved |= 1U << i;
+        }
+    }
+    uint32_t line = moved << 20;
+    for (int i = 0; i < PackedBoard::EXTENT; ++i)
+    {
+        line |= ((uint32_t)(v[i] & 0xF) << (4 * i)) | ((uint32_t)((v[i] >> 4) & 1) << (16 + i));
+    }
+    return line;
+}
+
+uint32_t CalculateLineScore(uint32_t a_line)
+{
+    uint32_t score = 0;
+    for (int i = 0; i < PackedBoard::EXTENT; ++i)
+    {
+        score += g_scores[((a_line >> (4 * i)) & 0xF) | (((a_line >> (16 + i)) & 1) << 4)];
+    }
+    return score;
+}
+
+struct LineMove
+{
+    uint32_t line; // resulting line (bits 0..19) and the mask of moved positions (bits 20..23)
+    uint32_t scoreDelta;
+};
+
+LineMove CalculateLineMove(uint32_t a_line, bool a_reverse)
+{
+    uint32_t result = MoveLine(a_reverse ? ReverseLine(a_line) : a_line);
+    uint8_t mask    = (uint8_t)(result >> 20);
+    result &= 0xFFFFF;
+    if (a_reverse)
+    {
+        result = ReverseLine(result);
+        mask   = ReverseBits4(mask);
+    }
+    LineMove move;
+    move.line       = result | ((uint32_t)mask << 20);
+    move.scoreDelta = CalculateLineScore(result) - CalculateLineScore(a_line);
+    return move;
+}
+
+// every line whose tiles fit into the nibble plane gets its move precomputed (towards position 0 and towards position 3).
+// lines touching the fifth bit plane are rare enough to be calculated on the fly.
+static struct LineTables
+{
+    LineTables()
+    {
+        for (uint32_t line = 0; line < LINE_COUNT; ++line)
+        {
+            moves[0][line] = CalculateLineMove(line, false);
+            moves[1][line] = CalculateLineMove(line, true);
+        }
+    }
+
+    enum
+    {
+        LINE_COUNT = 1 << 16
+    };
+    LineMove moves[2][LINE_COUNT];
+} g_lineTables;
+
+} // namespace
+
+uint16_t PackedBoard::EmptyMask() const
+{
+    // fold every nibble onto its lowest bit, then compress those bits into 16 consecutive ones
+    uint64_t x = lo | (lo >> 1);
+    x          = (x | (x >> 2)) & 0x1111111111111111ULL;
+    x          = (x | (x >> 3)) & 0x0303030303030303ULL;
+    x          = (x | (x >> 6)) & 0x000F000F000F000FULL;
+    x          = (x | (x >> 12)) & 0x000000FF000000FFULL;
+    x          = (x | (x >> 24)) & 0xFFFF;
+    return (uint16_t)~(x | hi);
+}
+
+uint8_t PackedBoard::CountEmpty() const
+{
+    uint16_t mask = EmptyMask();
+    uint8_t n     = 0;
+    for (; mask != 0; mask &= mask - 1)
+    {
+        ++n;
+    }
+    return n;
+}
+
+uint8_t PackedBoard::MaxTile() const
+{
+    uint8_t highest = 0;
+    for (uint8_t i = 0; i < SIZE; ++i)
+    {
+        const uint8_t value = Get(i);
+        if (value > highest)
+            highest = value;
+    }
+    return highest;
+}
+
+uint32_t PackedBoard::Score() const
+{
+    uint32_t score = 0;
+    for (uint8_t i = 0; i < SIZE; ++i)
+    {
+        score += g_scores[Get(i)];
+    }
+    return score;
+}
+
+bool PackedBoard::Move(EDirections a_dir, uint16_t* out_moved, uint32_t* out_scoreDelta)
+{
+    const bool vertical   = a_dir == EDirections::Up || a_dir == EDirections::Down;
+    const bool reverse    = a_dir == EDirections::Right || a_dir == EDirections::Down;
+    const LineMove* table = g_lineTables.moves[reverse ? 1 : 0];
+
+    const PackedBoard source = vertical ? Transposed() : *this;
+    PackedBoard board;
+    uint16_t moved      = 0;
+    uint32_t scoreDelta = 0;
+    for (uint8_t row = 0; row < EXTENT; ++row)
+    {
+        const uint32_t line = source.GetRow(row);
+        const LineMove move = (line >> 16) == 0 ? table[line] : CalculateLineMove(line, reverse);
+        board.lo |= (uint64_t)(move.line & 0xFFFF) << (16 * row);
+        board.hi |= (uint16_t)(((move.line >> 16) & 0xF) << (4 * row));
+        moved |= (uint16_t)((move.line >> 20) << (4 * row));
+        scoreDelta += move.scoreDelta;
+    }
+    if (vertical)
+    {
+        board = board.Transposed();
+        moved = TransposeHi(moved);
+    }
+
+    *this = board;
+    if (out_moved)
+        *out_moved = moved;
+    if (out_scoreDelta)
+        *out_scoreDelta = scoreDelta;
+    return moved != 0;
+}
+
+bool PackedBoard::CanMove(EDirections a_dir) const
+{
+    const bool vertical   = a_dir == EDirections::Up || a_dir == EDirections::Down;
+    const bool reverse    = a_dir == EDirections::Right || a_dir == EDirections::Down;
+    const LineMove* table = g_lineTables.moves[reverse ? 1 : 0];
+
+    const PackedBoard board = vertical ? Transposed() : *this;
+    for (uint8_t row = 0; row < EXTENT; ++row)
+    {
+        const uint32_t line = board.GetRow(row);
+        const LineMove move = (line >> 16) == 0 ? table[line] : CalculateLineMove(line, reverse);
+        if ((move.line >> 20) != 0)
+            return true;
+    }
+    return false;
+}
+
+bool PackedBoard::IsGameOver() const
+{
+    if (EmptyMask() != 0)
+    {
+        return false;
+    }
+    for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+    {
+        if (CanMove((EDirections)dir))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+PackedBoard PackedBoard::Transposed() const
+{
+    return PackedBoard(TransposeLo(lo), TransposeHi(hi));
+}
+
+PackedBoard PackedBoard::Transformed(uint8_t a_symmetry) const
+{
+    PackedBoard board = (a_symmetry & 4) ? Transposed() : *this;
+    if (a_symmetry & 1)
+        board = PackedBoard(MirrorLo(board.lo), MirrorHi(board.hi));
+    if (a_symmetry & 2)
+        board = PackedBoard(FlipLo(board.lo), FlipHi(board.hi));
+    return board;
+}
+
+PackedBoard PackedBoard::Canonical(uint8_t* out_symmetry) const
+{
+    const PackedBoard bases[2] = { *this, Transposed() };
+    PackedBoard best           = *this;
+    uint8_t bestSymmetry       = 0;
+    for (uint8_t t = 0; t < 2; ++t)
+    {
+        const PackedBoard& base       = bases[t];
+        const PackedBoard mirrored    = PackedBoard(MirrorLo(base.lo), MirrorHi(base.hi));
+        const PackedBoard variants[4] = {
+            base,
+            mirrored,
+            PackedBoard(FlipLo(base.lo), FlipHi(base.hi)),
+            PackedBoard(FlipLo(mirrored.lo), FlipHi(mirrored.hi)),
+        };
+        for (uint8_t i = 0; i < 4; ++i)
+        {
+            if (IsLess(variants[i], best))
+            {
+                best         = variants[i];
+                bestSymmetry = (uint8_t)(t * 4 + i);
+            }
+        }
+    }
+    if (out_symmetry)
+        *out_symmetry = bestSymmetry;
+    return best;
+}
+
+uint32_t PackedBoard::TileScore(uint8_t a_value)
+{
+    return g_scores[a_value & MAX_VALUE];
+}
+
+uint8_t PackedBoard::MovedLines(EDirections a_dir, uint16_t a_moved)
+{
+    uint8_t lines = 0;
+    if (a_dir == EDirections::Left || a_dir == EDirections::Right)
+    {
+        for (uint8_t y = 0; y < EXTENT; ++y)
+        {
+            lines |= (uint8_t)(((a_moved >> (4 * y)) & 0xF) != 0) << y;
+        }
+    }
+    else
+    {
+        lines = (uint8_t)((a_moved | (a_moved >> 4) | (a_moved >> 8) | (a_moved >> 12)) & 0xF);
+    }
+    return lines;
+}
+
+uint8_t PackedBoard::SpawnIndex(EDirections a_dir, uint8_t a_line)
+{
+    switch (a_dir)
+    {
+        case EDirections::Left: return a_line * EXTENT + (EXTENT - 1);
+        case EDirections::Right: return a_line * EXTENT;
+        case EDirections::Up: return (EXTENT - 1) * EXTENT + a_line;
+        case EDirections::Down: return a_line;
+        default: break;
+    }
+    return 0;
+}
+
+EDirections PackedBoard::TransformDirection(EDirections a_dir, uint8_t a_symmetry)
+{
+    if (a_dir == EDirections::COUNT)
+    {
+        return a_dir;
+    }
+    // Left/Right and Up/Down differ in bit 0, horizontal and vertical moves in bit 1
+    uint8_t dir = (uint8_t)a_dir;
+    if (a_symmetry & 4)
+        dir ^= 2;
+    if ((a_symmetry & 1) && dir < 2)
+        dir ^= 1;
+    if ((a_symmetry & 2) && dir >= 2)
+        dir ^= 1;
+    return (EDirections)dir;
+}
+
+uint8_t PackedBoard::InverseSymmetry(uint8_t a_symmetry)
+{
+    // mirrors and flips undo themselves; after a transpose, undoing them first means swapping the two
+    if ((a_symmetry & 4) == 0)
+    {
+        return a_symmetry;
+    }
+    return (uint8_t)(4 | ((a_symmetry & 1) << 1) | ((a_symmetry >> 1) & 1));
+}
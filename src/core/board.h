@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+
+enum class EDirections : uint8_t
+{
+    Left = 0,
+    Right,
+    Up,
+    Down,
+
+    COUNT,
+};
+
+// 4x4 board packed into two bit planes: the low nibble of tile i lives at bits 4i..4i+3 of `lo`,
+// its fifth bit at bit i of `hi`. tiles > 15 are rare, so most boards only ever touch `lo`.
+// tile indices are row major (index = y * EXTENT + x), matching Game::pos::ToIndex().
+struct PackedBoard
+{
+    static constexpr uint8_t EXTENT    = 4;
+    static constexpr uint8_t SIZE      = EXTENT * EXTENT;
+    static constexpr uint8_t MAX_VALUE = 31;
+    // rotations and reflections: bit 2 transposes, then bit 0 mirrors the rows and bit 1 flips their order
+    static constexpr uint8_t SYMMETRY_COUNT = 8;
+
+    uint64_t lo;
+    uint16_t hi;
+
+    PackedBoard()
+        : lo(0)
+        , hi(0)
+    {
+    }
+    PackedBoard(uint64_t a_lo, uint16_t a_hi)
+        : lo(a_lo)
+        , hi(a_hi)
+    {
+    }
+
+    inline uint8_t Get(uint8_t a_index) const
+    {
+        return (uint8_t)(((lo >> (4 * a_index)) & 0xF) | (((hi >> a_index) & 1) << 4));
+    }
+    inline void Set(uint8_t a_index, uint8_t a_value)
+    {
+        lo = (lo & ~(0xFULL << (4 * a_index))) | ((uint64_t)(a_value & 0xF) << (4 * a_index));
+        hi = (uint16_t)((hi & ~(1U << a_index)) | (((a_value >> 4) & 1U) << a_index));
+    }
+
+    // row a_row as a line: its 4 nibbles in bits 0..15 and their fifth bits in bits 16..19 (position i = column i)
+    inline uint32_t GetRow(uint8_t a_row) const
+    {
+        return (uint32_t)((lo >> (16 * a_row)) & 0xFFFF) | ((uint32_t)((hi >> (4 * a_row)) & 0xF) << 16);
+    }
+
+    // bit i is set if tile i is empty
+    uint16_t EmptyMask() const;
+    uint8_t CountEmpty() const;
+    uint8_t MaxTile() const;
+    uint32_t Score() const;
+
+    // shifts the board by one step in a_dir (without spawning a new tile).
+    // out_moved receives a mask of all tiles (by their source index) that moved or merged,
+    // out_scoreDelta the change of Score() caused by merges.
+    bool Move(EDirections a_dir, uint16_t* out_moved = nullptr, uint32_t* out_scoreDelta = nullptr);
+    bool CanMove(EDirections a_dir) const;
+    bool IsGameOver() const;
+
+    PackedBoard Transposed() const;
+    PackedBoard Transformed(uint8_t a_symmetry) const;
+    // the smallest of the 8 orientations, out_symmetry receives the one that produces it. boards that are
+    // rotations or reflections of each other share their canonical form and play the same, up to TransformDirection.
+    PackedBoard Canonical(uint8_t* out_symmetry = nullptr) const;
+
+    static uint32_t TileScore(uint8_t a_value);
+    // collapses a moved mask (see Move) into the rows (horizontal moves) or columns (vertical moves) that moved
+    static uint8_t MovedLines(EDirections a_dir, uint16_t a_moved);
+    // index of the cell a new tile enters line a_line through after a move in a_dir
+    static uint8_t SpawnIndex(EDirections a_dir, uint8_t a_line);
+    // moving a board in a_dir and transforming it by a_symmetry is the same as transforming it and moving in the result
+    static EDirections TransformDirection(EDirections a_dir, uint8_t a_symmetry);
+    static uint8_t InverseSymmetry(uint8_t a_symmetry);
+
+    bool operator==(const PackedBoard& a_other) const { return lo == a_other.lo && hi == a_other.hi; }
+    bool operator!=(const PackedBoard& a_other) const { return !(*this == a_other); }
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <core/random.h>
+#include <stdint.h>
+
+template <uint8_t SIZE>
+struct Deck
+{
+    Deck()
+        : m_n(0)
+    {
+    }
+
+    void Reset(Random& a_random)
+    {
+        for (int i = 0; i < SIZE; ++i)
+        {
+            m_buffer[i] = (i / (SIZE / 3)) + 1;
+        }
+        m_n = SIZE;
+        a_random.Shuffle(m_buffer);
+    }
+    bool IsEmpty() const
+    {
+        return m_n <= 0;
+    }
+    // cards of a_value not drawn yet
+    uint8_t Count(uint8_t a_value) const
+    {
+        uint8_t n = 0;
+        for (int i = 0; i < m_n; ++i)
+        {
+            n += m_buffer[i] == a_value;
+        }
+        return n;
+    }
+    uint8_t Pop()
+    {
+        return m_buffer[--m_n];
+    }
+    // new order for the cards not drawn yet
+    void ShuffleRemaining(Random& a_random)
+    {
+        a_random.Shuffle(m_buffer, m_n);
+    }
+
+private:
+    uint8_t m_buffer[SIZE];
+    uint8_t m_n;
+};
+
+template <typename T, uint8_t SIZE>
+struct RandomPool
+{
+    RandomPool()
+        : m_n(0)
+    {
+    }
+
+    void Push(const T& option)
+    {
+        m_options[m_n++] = option;
+    }
+    void PushUnique(const T& option)
+    {
+        for (int i = 0; i < m_n; ++i)
+        {
+            if (m_options[i] == option)
+            {
+                return;
+            }
+        }
+        Push(option);
+    }
+    T Pick(Random& a_random)
+    {
+        return m_options[a_random.Next() % m_n];
+    }
+    void Clear()
+    {
+        m_n = 0;
+    }
+
+private:
+    T m_options[SIZE];
+    uint8_t m_n;
+};
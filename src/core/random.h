@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// PCG based. the increment selects one of 2^63 independent streams, Advance() jumps ahead in O(log n) -
+// so parallel workers can either take a stream each or disjoint slices of one stream, reproducibly.
+struct Random
+{
+    // stream and position derived from the seed alone
+    explicit Random(uint32_t a_seed)
+    {
+        uint64_t value = (((uint64_t)a_seed) << 1ULL) | 1ULL;
+        value          = Murmur3Avalanche64(value);
+        m_state[0]     = 0U;
+        m_state[1]     = (value << 1ULL) | 1ULL;
+        Next();
+        m_state[0] += Murmur3Avalanche64(value);
+        Next();
+    }
+    // explicit stream selection: equal seeds on different streams give unrelated sequences
+    Random(uint64_t a_seed, uint64_t a_stream)
+    {
+        m_state[0] = 0U;
+        m_state[1] = (a_stream << 1ULL) | 1ULL;
+        Next();
+        m_state[0] += a_seed;
+        Next();
+    }
+    uint32_t Next()
+    {
+        uint64_t oldstate   = m_state[0];
+        m_state[0]          = oldstate * MULTIPLIER + m_state[1];
+        uint32_t xorshifted = (uint32_t)(((oldstate >> 18ULL) ^ oldstate) >> 27ULL);
+        uint32_t rot        = (uint32_t)(oldstate >> 59ULL);
+        return (xorshifted >> rot) | (xorshifted << ((-(int)rot) & 31));
+    }
+    // same as calling Next() a_delta times
+    void Advance(uint64_t a_delta)
+    {
+        uint64_t accMult = 1U;
+        uint64_t accPlus = 0U;
+        uint64_t curMult = MULTIPLIER;
+        uint64_t curPlus = m_state[1];
+        for (; a_delta > 0; a_delta >>= 1)
+        {
+            if (a_delta & 1)
+            {
+                accMult *= curMult;
+                accPlus = accPlus * curMult + curPlus;
+            }
+            curPlus = (curMult + 1) * curPlus;
+            curMult *= curMult;
+        }
+        m_state[0] = accMult * m_state[0] + accPlus;
+    }
+    template <typename T>
+    void Shuffle(T* a_buffer, size_t a_size)
+    {
+        for (size_t i = 0; i < a_size; ++i)
+        {
+            const size_t j = Next() % a_size;
+            const T temp   = a_buffer[i];
+            a_buffer[i]    = a_buffer[j];
+            a_buffer[j]    = temp;
+        }
+    }
+    template <typename T, size_t SIZE>
+    inline void Shuffle(T (&a_buffer)[SIZE])
+    {
+        Shuffle(a_buffer, SIZE);
+    }
+
+private:
+    static constexpr uint64_t MULTIPLIER = 0x5851f42d4c957f2dULL;
+
+    static uint64_t Murmur3Avalanche64(uint64_t a_value)
+    {
+        a_value ^= a_value >> 33;
+        a_value *= 0xff51afd7ed558ccd;
+        a_value ^= a_value >> 33;
+        a_value *= 0xc4ceb9fe1a85ec53;
+        a_value ^= a_value >> 33;
+        return a_value;
+    }
+    uint64_t m_state[2];
+};
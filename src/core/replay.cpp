@@ -0,0 +1,137 @@
+#include "replay.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+const char g_magic[4] = { 'T', 'T', 'R', 'P' };
+
+void WriteUInt32(uint8_t* out_bytes, uint32_t a_value)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        out_bytes[i] = (uint8_t)(a_value >> (8 * i));
+    }
+}
+
+uint32_t ReadUInt32(const uint8_t* a_bytes)
+{
+    return (uint32_t)a_bytes[0] | ((uint32_t)a_bytes[1] << 8) | ((uint32_t)a_bytes[2] << 16) | ((uint32_t)a_bytes[3] << 24);
+}
+
+} // namespace
+
+Replay::Replay(uint32_t a_seed)
+{
+    Reset(a_seed);
+}
+
+void Replay::Reset(uint32_t a_seed)
+{
+    m_seed  = a_seed;
+    m_count = 0;
+    m_moves.clear();
+}
+
+void Replay::Push(EDirections a_dir)
+{
+    if (m_count % 4 == 0)
+        m_moves.push_back(0);
+    m_moves.back() |= (uint8_t)(((uint8_t)a_dir & 3) << (2 * (m_count % 4)));
+    ++m_count;
+}
+
+void Replay::Serialize(uint8_t* out_bytes) const
+{
+    memcpy(out_bytes, g_magic, sizeof(g_magic));
+    out_bytes[4] = FORMAT_VERSION;
+    out_bytes[5] = Threes::RULES_VERSION;
+    WriteUInt32(out_bytes + 6, m_seed);
+    WriteUInt32(out_bytes + 10, m_count);
+    if (!m_moves.empty())
+        memcpy(out_bytes + HEADER_SIZE, m_moves.data(), m_moves.size());
+}
+
+bool Replay::Deserialize(const uint8_t* a_bytes, size_t a_size, size_t* out_size)
+{
+    if (a_size < HEADER_SIZE || memcmp(a_bytes, g_magic, sizeof(g_magic)) != 0 ||
+        a_bytes[4] != FORMAT_VERSION || a_bytes[5] != Threes::RULES_VERSION)
+    {
+        return false;
+    }
+    const uint32_t count = ReadUInt32(a_bytes + 10);
+    const size_t bytes   = ((size_t)count + 3) / 4;
+    if (a_size - HEADER_SIZE < bytes)
+    {
+        return false;
+    }
+    m_seed  = ReadUInt32(a_bytes + 6);
+    m_count = count;
+    m_moves.assign(a_bytes + HEADER_SIZE, a_bytes + HEADER_SIZE + bytes);
+    if (out_size)
+        *out_size = HEADER_SIZE + bytes;
+    return true;
+}
+
+bool Replay::Load(const char* a_path)
+{
+    FILE* file = fopen(a_path, "rb");
+    if (!file)
+    {
+        return false;
+    }
+    std::vector<uint8_t> bytes;
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        bytes.insert(bytes.end(), buffer, buffer + n);
+    }
+    fclose(file);
+    return !bytes.empty() && Deserialize(bytes.data(), bytes.size());
+}
+
+bool Replay::Save(const char* a_path) const
+{
+    FILE* file = fopen(a_path, "wb");
+    if (!file)
+    {
+        return false;
+    }
+    std::vector<uint8_t> bytes(GetSerializedSize());
+    Serialize(bytes.data());
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    ok &= fclose(file) == 0;
+    return ok;
+}
+
+bool Replay::Play(Threes& out_game) const
+{
+    out_game = Threes(m_seed);
+    for (uint32_t i = 0; i < m_count; ++i)
+    {
+        if (!out_game.Move(Get(i)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+ReplayReader::ReplayReader(const Replay& a_replay)
+    : m_replay(a_replay)
+    , m_game(a_replay.GetSeed())
+    , m_index(0)
+{
+}
+
+bool ReplayReader::Next()
+{
+    if (IsDone() || !m_game.Move(GetMove()))
+    {
+        return false;
+    }
+    ++m_index;
+    return true;
+}
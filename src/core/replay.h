@@ -0,0 +1,64 @@
+#pragma once
+
+#include <core/board.h>
+#include <core/threes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// a game as its seed and its moves: Threes(seed) and the same moves rebuild every board along the way.
+// serialized as "TTRP", format version, Threes::RULES_VERSION, seed and move count (both little endian uint32),
+// then the moves at 2 bits each, 4 per byte, the first move in the lowest bits of the first byte.
+struct Replay
+{
+    static constexpr uint8_t FORMAT_VERSION = 1;
+    static constexpr size_t HEADER_SIZE     = 14;
+
+    explicit Replay(uint32_t a_seed = 0);
+
+    // starts an empty replay of a new game
+    void Reset(uint32_t a_seed);
+    // records a move that was made (only moves Threes::Move accepted belong here)
+    void Push(EDirections a_dir);
+    EDirections Get(uint32_t a_index) const { return (EDirections)((m_moves[a_index / 4] >> (2 * (a_index % 4))) & 3); }
+
+    uint32_t GetSeed() const { return m_seed; }
+    uint32_t GetMoveCount() const { return m_count; }
+    size_t GetSerializedSize() const { return HEADER_SIZE + m_moves.size(); }
+
+    // writes GetSerializedSize() bytes
+    void Serialize(uint8_t* out_bytes) const;
+    // false unless a_bytes starts with a replay of this format and rules version; bytes past it are ignored,
+    // out_size receives the bytes it took
+    bool Deserialize(const uint8_t* a_bytes, size_t a_size, size_t* out_size = nullptr);
+    bool Load(const char* a_path);
+    bool Save(const char* a_path) const;
+
+    // plays every move on a new game; false if one of them is not legal (a corrupt replay)
+    bool Play(Threes& out_game) const;
+
+private:
+    uint32_t m_seed;
+    uint32_t m_count;
+    std::vector<uint8_t> m_moves;
+};
+
+// steps through a replay with the rules, for looking at every position the game went through
+struct ReplayReader
+{
+    explicit ReplayReader(const Replay& a_replay);
+
+    // the position before move GetMoveIndex()
+    const Threes& GetGame() const { return m_game; }
+    uint32_t GetMoveIndex() const { return m_index; }
+    bool IsDone() const { return m_index >= m_replay.GetMoveCount(); }
+    // the move the player made in the current position
+    EDirections GetMove() const { return m_replay.Get(m_index); }
+    // plays GetMove(); false at the end of the replay or if the move is not legal
+    bool Next();
+
+private:
+    const Replay& m_replay;
+    Threes m_game;
+    uint32_t m_index;
+};
@@ -0,0 +1,187 @@
+#include "threes.h"
+
+Threes::Threes(uint32_t a_seed)
+    : next(0)
+    , m_random(a_seed)
+{
+    Reset();
+}
+
+Threes::Threes(const Random& a_random)
+    : next(0)
+    , m_random(a_random)
+{
+    Reset();
+}
+
+void Threes::Reset()
+{
+    m_deck.Reset(m_random);
+    board = PackedBoard();
+    board.Set(2, 1);
+    board.Set(3, 2);
+    board.Set(8, 3);
+    int n = 0;
+    while (n < START_TILES)
+    {
+        const uint8_t index = (uint8_t)(m_random.Next() % PackedBoard::SIZE);
+        if (board.Get(index) == 0)
+        {
+            board.Set(index, PickRandomValue());
+            ++n;
+        }
+    }
+    next = PickRandomValue();
+}
+
+void Threes::Reseed(const Random& a_random)
+{
+    m_random = a_random;
+    m_deck.ShuffleRemaining(m_random);
+}
+
+bool Threes::Move(EDirections a_dir, MoveResult* out_result)
+{
+    uint16_t moved;
+    uint32_t scoreDelta;
+    if (!board.Move(a_dir, &moved, &scoreDelta))
+    {
+        return false;
+    }
+
+    const uint8_t spawnIndex = PickRandomTarget(a_dir, moved);
+    const uint8_t spawnValue = next;
+    board.Set(spawnIndex, spawnValue);
+    next = PickRandomValue();
+
+    if (out_result)
+    {
+        out_result->moved      = moved;
+        out_result->scoreDelta = scoreDelta + PackedBoard::TileScore(spawnValue);
+        out_result->spawnIndex = spawnIndex;
+        out_result->spawnValue = spawnValue;
+    }
+    return true;
+}
+
+uint8_t Threes::PickRandomValue()
+{
+    // pretty much exactly taken from threesjs, with the math modified to match the value representation used here.
+    const uint8_t highest = board.MaxTile();
+    if (highest >= BONUS_MIN_TILE && (m_random.Next() % 100) < BONUS_PERCENT)
+    {
+        // bonus tiles range from 6 up to an eighth of the highest tile
+        RandomPool<uint8_t, PackedBoard::MAX_VALUE> bonusDeck;
+        for (uint8_t value = 4; value <= highest - 3; ++value)
+        {
+            bonusDeck.Push(value);
+        }
+        return bonusDeck.Pick(m_random);
+    }
+
+    if (m_deck.IsEmpty())
+    {
+        m_deck.Reset(m_random);
+    }
+    return m_deck.Pop();
+}
+
+uint8_t Threes::PickRandomTarget(EDirections a_dir, uint16_t a_moved)
+{
+    const uint8_t lines = PackedBoard::MovedLines(a_dir, a_moved);
+    RandomPool<uint8_t, PackedBoard::EXTENT> pool;
+    for (uint8_t line = 0; line < PackedBoard::EXTENT; ++line)
+    {
+        if (lines & (1 << line))
+        {
+            pool.Push(line);
+        }
+    }
+    return PackedBoard::SpawnIndex(a_dir, pool.Pick(m_random));
+}
+
+Threes::DeckState Threes::GetDeckState() const
+{
+    DeckState deck;
+    for (uint8_t value = 1; value <= 3; ++value)
+    {
+        deck.counts[value - 1] = m_deck.Count(value);
+    }
+    return deck;
+}
+
+uint8_t Threes::CalculateTileChances(const PackedBoard& a_board, const DeckState& a_deck, TileChance* out_chances)
+{
+    const uint8_t highest = a_board.MaxTile();
+    const float bonus     = highest >= BONUS_MIN_TILE ? BONUS_PERCENT / 100.0f : 0.0f;
+
+    // an empty deck is refilled before the draw
+    const DeckState deck = a_deck.IsKnown() && a_deck.Remaining() == 0 ? DeckState::Full() : a_deck;
+    uint8_t n            = 0;
+    for (uint8_t value = 1; value <= 3; ++value)
+    {
+        if (!deck.IsKnown())
+        {
+            out_chances[n].value       = value;
+            out_chances[n].probability = (1.0f - bonus) / 3.0f;
+            ++n;
+        }
+        else if (deck.counts[value - 1] > 0)
+        {
+            out_chances[n].value       = value;
+            out_chances[n].probability = (1.0f - bonus) * deck.counts[value - 1] / deck.Remaining();
+            ++n;
+        }
+    }
+    if (bonus > 0.0f)
+    {
+        const uint8_t bonusCount = highest - 6;
+        for (uint8_t value = 4; value <= highest - 3; ++value)
+        {
+            out_chances[n].value       = value;
+            out_chances[n].probability = bonus / bonusCount;
+            ++n;
+        }
+    }
+    return n;
+}
+
+Threes::DeckState Threes::DeckState::Unknown()
+{
+    DeckState deck;
+    deck.counts[0] = UNKNOWN;
+    deck.counts[1] = 0;
+    deck.counts[2] = 0;
+    return deck;
+}
+
+Threes::DeckState Threes::DeckState::Full()
+{
+    DeckState deck;
+    deck.counts[0] = CARDS_PER_VALUE;
+    deck.counts[1] = CARDS_PER_VALUE;
+    deck.counts[2] = CARDS_PER_VALUE;
+    return deck;
+}
+
+uint8_t Threes::DeckState::Index() const
+{
+    const uint8_t base = CARDS_PER_VALUE + 1;
+    return IsKnown() ? (uint8_t)((counts[0] * base + counts[1]) * base + counts[2]) : INDEX_COUNT - 1;
+}
+
+Threes::DeckState Threes::DeckState::Drawn(uint8_t a_value) const
+{
+    if (!IsKnown() || a_value < 1 || a_value > 3)
+    {
+        return *this;
+    }
+    DeckState deck = Remaining() == 0 ? Full() : *this;
+    --deck.counts[a_value - 1];
+    return deck;
+}
+
+bool Threes::DeckState::operator==(const DeckState& a_other) const
+{
+    return counts[0] == a_other.counts[0] && counts[1] == a_other.counts[1] && counts[2] == a_other.counts[2];
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <core/board.h>
+#include <core/deck.h>
+#include <core/random.h>
+#include <stdint.h>
+
+// the rules of the game without any presentation: board, next tile generation and game over / win detection.
+// every instance owns its random state, so any number of games can run side by side.
+struct Threes
+{
+    static constexpr uint8_t DECK_SIZE      = 12;
+    static constexpr uint8_t START_TILES    = 9;
+    static constexpr uint8_t BONUS_MIN_TILE = 7; // a bonus tile may show up once the board holds a 48
+    static constexpr uint8_t BONUS_PERCENT  = 5;
+    static constexpr uint8_t WIN_TILE       = 27;
+    // bump with every change to the rules or to the random draws, a seed and its moves replay another game then
+    static constexpr uint8_t RULES_VERSION = 1;
+
+    struct TileChance
+    {
+        uint8_t value;
+        float probability;
+    };
+    static constexpr uint8_t MAX_TILE_CHANCES = 32;
+
+    // the cards left in the deck by value, the part of the game state a search needs for the exact odds of the
+    // next draw. an unknown deck stands for "any deck" and falls back to the long run odds.
+    struct DeckState
+    {
+        static constexpr uint8_t CARDS_PER_VALUE = DECK_SIZE / 3;
+        static constexpr uint8_t UNKNOWN         = 0xFF;
+        static constexpr uint8_t INDEX_COUNT     = (CARDS_PER_VALUE + 1) * (CARDS_PER_VALUE + 1) * (CARDS_PER_VALUE + 1) + 1;
+
+        uint8_t counts[3]; // cards of value 1, 2 and 3 left, UNKNOWN in counts[0] if not known
+
+        static DeckState Unknown();
+        static DeckState Full();
+
+        bool IsKnown() const { return counts[0] != UNKNOWN; }
+        uint8_t Remaining() const { return (uint8_t)(counts[0] + counts[1] + counts[2]); }
+        // dense index in [0, INDEX_COUNT), the last one being the unknown deck
+        uint8_t Index() const;
+        // the deck after a_value was drawn: bonus tiles leave it alone, an empty deck gets refilled first
+        DeckState Drawn(uint8_t a_value) const;
+
+        bool operator==(const DeckState& a_other) const;
+        bool operator!=(const DeckState& a_other) const { return !(*this == a_other); }
+    };
+
+    struct MoveResult
+    {
+        uint16_t moved      = 0; // source indices of all moved tiles
+        uint32_t scoreDelta = 0; // change of board.Score(), including the spawned tile
+        uint8_t spawnIndex  = 0;
+        uint8_t spawnValue  = 0;
+    };
+
+    explicit Threes(uint32_t a_seed);
+    // every draw (deck shuffles, bonus rolls, spawn lines) comes from a_random, e.g. one stream per worker
+    explicit Threes(const Random& a_random);
+
+    void Reset();
+    // continues the same position with other random draws (the cards left in the deck get reshuffled),
+    // so copies of a game can play out futures the original does not know about
+    void Reseed(const Random& a_random);
+    // moves the board, spawns `next` at the trailing edge of a line that moved and draws the tile after it.
+    bool Move(EDirections a_dir, MoveResult* out_result = nullptr);
+    bool IsGameOver() const { return board.IsGameOver(); }
+    bool IsGameWon() const { return board.MaxTile() >= WIN_TILE; }
+
+    uint8_t PickRandomValue();
+    uint8_t PickRandomTarget(EDirections a_dir, uint16_t a_moved);
+
+    DeckState GetDeckState() const;
+
+    // distribution of the tile PickRandomValue draws for a_board with a_deck left: only values that can still
+    // come up, with exact probabilities (or the long run odds for an unknown deck).
+    // returns the number of entries written to out_chances (at most MAX_TILE_CHANCES).
+    static uint8_t CalculateTileChances(const PackedBoard& a_board, const DeckState& a_deck, TileChance* out_chances);
+    static uint8_t CalculateTileChances(const PackedBoard& a_board, TileChance* out_chances)
+    {
+        return CalculateTileChances(a_board, DeckState::Unknown(), out_chances);
+    }
+
+    PackedBoard board;
+    uint8_t next;
+
+private:
+    Random m_random;
+    Deck<DECK_SIZE> m_deck;
+};
@@ -2,42 +2,13 @@
 #define TUI_IMPLEMENTATION
 #include "tui.hpp"
 
+#include <string.h>
+
 namespace
 {
-const char* g_bindings = "Restart (F5) | Quit (q)";
+const char* g_bindings = "Hint (h) | Restart (F5) | Quit (q)";
+const char* g_directionNames[(int)EDirections::COUNT] = { "Left", "Right", "Up", "Down" };
 // we have limited space in our tiles - therefore we have a limited number of possible tile values.
-// btw, formula for the tile values: f(i) = floor(2^i - 2^(i-2))
-//  => let's bake em in!
-uint g_scores[] = {
-           0,
-           1,
-           2,
-           3,
-           6,
-          12,
-          24,
-          48,
-          96,
-         192,
-         384,
-         768,
-        1536,
-        3072,
-        6144,
-       12288,
-       24576,
-       49152,
-       98304,
-      196608,
-      393216,
-      786432,
-     1572864,
-     3145728,
-     6291456,
-     1582912,
-    25165824,
-    50331648,
-};
 const char g_texts[][9] = {
     "        ",
     "    1   ",
@@ -69,56 +40,6 @@ const char g_texts[][9] = {
     "50331648",
 };
 
-static struct Random // PCG based
-{
-    Random(uint32_t a_seed)
-    {
-        uint64_t value = (((uint64_t)a_seed) << 1ULL) | 1ULL;
-        value          = Murmur3Avalanche64(value);
-        m_state[0]     = 0U;
-        m_state[1]     = (value << 1ULL) | 1ULL;
-        Next();
-        m_state[0] += Murmur3Avalanche64(value);
-        Next();
-    }
-    uint32_t Next()
-    {
-        uint64_t oldstate   = m_state[0];
-        m_state[0]          = oldstate * 0x5851f42d4c957f2dULL + m_state[1];
-        uint32_t xorshifted = (uint32_t)(((oldstate >> 18ULL) ^ oldstate) >> 27ULL);
-        uint32_t rot        = (uint32_t)(oldstate >> 59ULL);
-        return (xorshifted >> rot) | (xorshifted << ((-(int)rot) & 31));
-    }
-    template <typename T>
-    void Shuffle(T* a_buffer, size_t a_size)
-    {
-        for (size_t i = 0; i < a_size; ++i)
-        {
-            const size_t j = Next() % a_size;
-            const T temp   = a_buffer[i];
-            a_buffer[i]    = a_buffer[j];
-            a_buffer[j]    = temp;
-        }
-    }
-    template <typename T, size_t SIZE>
-    inline void Shuffle(T (&a_buffer)[SIZE])
-    {
-        Shuffle(a_buffer, SIZE);
-    }
-
-private:
-    static uint64_t Murmur3Avalanche64(uint64_t a_value)
-    {
-        a_value ^= a_value >> 33;
-        a_value *= 0xff51afd7ed558ccd;
-        a_value ^= a_value >> 33;
-        a_value *= 0xc4ceb9fe1a85ec53;
-        a_value ^= a_value >> 33;
-        return a_value;
-    }
-    uint64_t m_state[2];
-} g_random((uint32_t)time(NULL));
-
 struct
 {
     TUI::EKeys key;
@@ -127,80 +48,13 @@ struct
     // note: order determines priority (descending)!
     { TUI::EKeys::Key_Q, Game::EInputs::Quit },
     { TUI::EKeys::Key_F5, Game::EInputs::Restart },
+    { TUI::EKeys::Key_H, Game::EInputs::Hint },
     { TUI::EKeys::Key_Left, Game::EInputs::Left },
     { TUI::EKeys::Key_Up, Game::EInputs::Up },
     { TUI::EKeys::Key_Right, Game::EInputs::Right },
     { TUI::EKeys::Key_Down, Game::EInputs::Down },
     { TUI::EKeys::Key_Space, Game::EInputs::Space },
 };
-template <uint8_t SIZE>
-struct Deck
-{
-    Deck()
-    {
-        Reset();
-    }
-
-    void Reset()
-    {
-        for (int i = 0; i < SIZE; ++i)
-        {
-            m_buffer[i] = (i / (SIZE / 3)) + 1;
-        }
-        m_n = SIZE;
-        g_random.Shuffle(m_buffer);
-    }
-    bool IsEmpty() const
-    {
-        return m_n <= 0;
-    }
-    uint8_t Pop()
-    {
-        return m_buffer[--m_n];
-    }
-
-private:
-    uint8_t m_buffer[SIZE];
-    uint8_t m_n;
-};
-Deck<12> g_deck;
-template <typename T, uint8_t SIZE>
-struct RandomPool
-{
-    RandomPool()
-        : m_n(0)
-    {
-    }
-
-    void Push(const T& option)
-    {
-        m_options[m_n++] = option;
-    }
-    void PushUnique(const T& option)
-    {
-        for (int i = 0; i < m_n; ++i)
-        {
-            if (m_options[i] == option)
-            {
-                return;
-            }
-        }
-        Push(option);
-    }
-    T Pick()
-    {
-        return m_options[g_random.Next() % m_n];
-    }
-    void Clear()
-    {
-        m_n = 0;
-    }
-
-private:
-    T m_options[SIZE];
-    uint8_t m_n;
-};
-RandomPool<uint8_t, 32> g_bonus_deck;
 
 struct BoardRenderer
 {
@@ -293,11 +147,12 @@ struct BoardRenderer
             for (uint8_t x = 0; x < Game::BOARD_EXTENT; ++x)
             {
                 Game::pos p(x, y);
-                if (a_state.tiles[p.ToIndex()] == 0)
+                const uint8_t value = a_state.Get(p.ToIndex());
+                if (value == 0)
                 {
                     continue;
                 }
-                RenderTile(a_cfg, a_state.tiles[p.ToIndex()], CalculateRenderPosition(a_cfg, p));
+                RenderTile(a_cfg, value, CalculateRenderPosition(a_cfg, p));
             }
         }
         // // draw moving tiles
@@ -323,23 +178,16 @@ struct BoardRenderer
     }
 };
 
-} // namespace
-
-Game::Board::Board()
+Expectimax::Config MakeHintConfig(const Game::Config& a_cfg)
 {
-    Reset();
+    Expectimax::Config cfg;
+    cfg.depth   = a_cfg.hintDepth;
+    cfg.ttBytes = 32 << 20;
+    cfg.star1   = true;
+    return cfg;
 }
 
-void Game::Board::Reset()
-{
-    for (int i = 0; i < BOARD_SIZE; ++i)
-    {
-        tiles[i] = 0;
-    }
-    tiles[2] = 1;
-    tiles[3] = 2;
-    tiles[8] = 3;
-}
+} // namespace
 
 Game::BoardAnimation::BoardAnimation()
 {
@@ -355,14 +203,13 @@ void Game::BoardAnimation::Reset()
 {
     alpha   = 0.0f;
     nMoving = 0;
-    for (int i = 0; i < BOARD_SIZE; ++i)
-    {
-        result[i] = 0;
-    }
 }
 
 Game::Game()
-    : quit(false)
+    : rules((uint32_t)time(NULL))
+    , hints(MakeHintConfig(cfg), &TUI::Wake)
+    , showHint(false)
+    , quit(false)
 {
     TUI::Init();
     Reset();
@@ -394,120 +241,59 @@ int Game::Tick()
     EInputs input = ReadInput();
     bool active   = Update(input);
 
+    // the hint engine improves its answer in the background, a better one is drawn as soon as it shows up
+    const HintEngine::Hint hint = hints.GetHint();
+    if (showHint && hint != shownHint)
+    {
+        shownHint = hint;
+        active    = true;
+    }
+
     if (sizeChanged || active)
         Draw();
 
-    TUI::EndFrame();
+    if (phase == EPhases::Animating)
+    {
+        TUI::EndFrame();
+    }
+    else
+    {
+        // nothing moves on its own: sleep until a key, a resize or a new hint instead of waking up every frame
+        TUI::EndFrame(0);
+        TUI::WaitForEvents();
+    }
 
     return 0;
 }
 
 void Game::Reset()
 {
-    g_deck.Reset();
-    state.Reset();
+    rules.Reset();
+    state.packed = rules.board;
     anim.Reset();
-    int n = 0;
-    while (n < 9)
-    {
-        pos p(
-            g_random.Next() % BOARD_EXTENT,
-            g_random.Next() % BOARD_EXTENT);
-        if (state.tiles[p.ToIndex()] == 0)
-        {
-            state.tiles[p.ToIndex()] = PickRandomValue();
-            ++n;
-        }
-    }
-    next  = PickRandomValue();
     phase = EPhases::Active;
+    RefreshHint();
 }
 
-uint8_t Game::CalculateTileMoveResult(pos a_from, pos a_diff)
+// order in which tiles were visited by the former per tile scan (leading edge excluded).
+// animations are pushed in this order, which only decides the order they are drawn in.
+Game::pos Game::CalculateScanPosition(EInputs a_dir, int a_i)
 {
-    pos to = a_from + a_diff;
-    if ((state.tiles[a_from.ToIndex()] == 1 && state.tiles[to.ToIndex()] == 2) ||
-        (state.tiles[a_from.ToIndex()] == 2 && state.tiles[to.ToIndex()] == 1)) // combine small numbers
-    {
-        return 3;
-    }
-    else if (state.tiles[a_from.ToIndex()] != 0 && state.tiles[to.ToIndex()] == 0) // move to empty field
-    {
-        return state.tiles[a_from.ToIndex()];
-    }
-    else if (state.tiles[a_from.ToIndex()] >= 3 && state.tiles[a_from.ToIndex()] == state.tiles[to.ToIndex()]) // combine non-small equal numbers
-    {
-        return state.tiles[a_from.ToIndex()] + 1;
-    }
-    return 0;
-}
-
-bool Game::IsBoardMovePossible(EInputs a_dir)
-{
-    pos diff = CalculateMoveDiff(a_dir);
+    const int last = BOARD_EXTENT - 1;
     switch (a_dir)
     {
-        case EInputs::Left:
-            for (int x = 1; x < BOARD_EXTENT; ++x)
-                for (int y = 0; y < BOARD_EXTENT; ++y)
-                    if (CalculateTileMoveResult(pos(x, y), diff) > 0)
-                        return true;
-            break;
-        case EInputs::Right:
-            for (int x = BOARD_EXTENT - 2; x >= 0; --x)
-                for (int y = 0; y < BOARD_EXTENT; ++y)
-                    if (CalculateTileMoveResult(pos(x, y), diff) > 0)
-                        return true;
-            break;
-        case EInputs::Up:
-            for (int x = 0; x < BOARD_EXTENT; ++x)
-                for (int y = 1; y < BOARD_EXTENT; ++y)
-                    if (CalculateTileMoveResult(pos(x, y), diff) > 0)
-                        return true;
-            break;
-        case EInputs::Down:
-            for (int x = 0; x < BOARD_EXTENT; ++x)
-                for (int y = BOARD_EXTENT - 2; y >= 0; --y)
-                    if (CalculateTileMoveResult(pos(x, y), diff) > 0)
-                        return true;
-            break;
+        case EInputs::Left: return pos(1 + a_i / BOARD_EXTENT, a_i % BOARD_EXTENT);
+        case EInputs::Right: return pos(last - 1 - a_i / BOARD_EXTENT, a_i % BOARD_EXTENT);
+        case EInputs::Up: return pos(a_i / last, 1 + a_i % last);
+        case EInputs::Down: return pos(a_i / last, last - 1 - a_i % last);
         default: break;
     }
-    return false;
-}
-
-bool Game::IsGameOver()
-{
-    for (int i = 0; i < BOARD_SIZE; ++i)
-    {
-        if (state.tiles[i] == 0)
-        {
-            return false;
-        }
-    }
-
-    for (uint8_t dir = static_cast<uint8_t>(EInputs::FirstDir); dir <= static_cast<uint8_t>(EInputs::LastDir); ++dir)
-    {
-        if (IsBoardMovePossible(static_cast<EInputs>(dir)))
-        {
-            return false;
-        }
-    }
-
-    return true;
+    return pos(0, 0);
 }
 
-bool Game::IsGameWon()
+EDirections Game::ToDirection(EInputs a_dir)
 {
-    for (int i = 0; i < BOARD_SIZE; ++i)
-    {
-        constexpr int max = sizeof(g_texts) / sizeof(g_texts[0]) - 1;
-        if (state.tiles[i] == max)
-        {
-            return true;
-        }
-    }
-    return false;
+    return static_cast<EDirections>(static_cast<uint8_t>(a_dir) - static_cast<uint8_t>(EInputs::FirstDir));
 }
 
 Game::pos Game::CalculateMoveDiff(EInputs a_dir)
@@ -523,123 +309,36 @@ Game::pos Game::CalculateMoveDiff(EInputs a_dir)
     return pos(0, 0);
 }
 
-bool Game::TryMoveTile(pos a_from, pos a_diff)
-{
-    uint8_t result = CalculateTileMoveResult(a_from, a_diff);
-    if (result > 0)
-    {
-        pos to = a_from + a_diff;
-        anim.Push(TileAnimation(a_from, to, state.tiles[a_from.ToIndex()]));
-        anim.result[to.ToIndex()]     = result;
-        state.tiles[a_from.ToIndex()] = 0;
-        return true;
-    }
-    return false;
-}
-
 bool Game::TryMoveBoard(EInputs dir)
 {
-    pos diff = CalculateMoveDiff(dir);
-    bool any = false;
-    switch (dir)
+    if (dir < EInputs::FirstDir || dir > EInputs::LastDir)
     {
-        case EInputs::Left:
-            for (int x = 1; x < BOARD_EXTENT; ++x)
-                for (int y = 0; y < BOARD_EXTENT; ++y)
-                    any |= TryMoveTile(pos(x, y), diff);
-            break;
-        case EInputs::Right:
-            for (int x = BOARD_EXTENT - 2; x >= 0; --x)
-                for (int y = 0; y < BOARD_EXTENT; ++y)
-                    any |= TryMoveTile(pos(x, y), diff);
-            break;
-        case EInputs::Up:
-            for (int x = 0; x < BOARD_EXTENT; ++x)
-                for (int y = 1; y < BOARD_EXTENT; ++y)
-                    any |= TryMoveTile(pos(x, y), diff);
-            break;
-        case EInputs::Down:
-            for (int x = 0; x < BOARD_EXTENT; ++x)
-                for (int y = BOARD_EXTENT - 2; y >= 0; --y)
-                    any |= TryMoveTile(pos(x, y), diff);
-            break;
-        default: break;
+        return false;
     }
 
-    if (any)
+    const PackedBoard from = rules.board;
+    Threes::MoveResult move;
+    if (!rules.Move(ToDirection(dir), &move))
     {
-        pos new_pos                    = PickRandomTarget(dir);
-        anim.result[new_pos.ToIndex()] = next;
-        anim.Push(TileAnimation(new_pos - diff, new_pos, next));
-        next = PickRandomValue();
+        return false;
     }
 
-    return any;
-}
-
-uint8_t Game::PickRandomValue()
-{
-    // pretty much exactly taken from threesjs, with the math modified to match the value representation used here.
-    bool bonus      = false;
-    uint8_t highest = 0;
-    for (uint8_t value : state.tiles)
-    {
-        if (value >= 7)
-            bonus = true;
-        if (value > highest)
-            highest = value;
-    }
-    if (bonus && (rand() % 100) < 5)
+    // moving tiles are drawn by the animation until it finished, the board only keeps the ones that stay
+    pos diff = CalculateMoveDiff(dir);
+    for (int i = 0; i < BOARD_SIZE - BOARD_EXTENT; ++i)
     {
-        g_bonus_deck.Clear();
-        uint8_t size = highest - 2 * 3;
-        for (int i = 0; i < size; ++i)
+        pos p = CalculateScanPosition(dir, i);
+        if ((move.moved & (1 << p.ToIndex())) == 0)
         {
-            g_bonus_deck.Push(4 + i);
+            continue;
         }
-        return g_bonus_deck.Pick();
+        anim.Push(TileAnimation(p, p + diff, from.Get(p.ToIndex())));
+        state.Set(p.ToIndex(), 0);
     }
+    pos spawn(move.spawnIndex);
+    anim.Push(TileAnimation(spawn - diff, spawn, move.spawnValue));
 
-    if (g_deck.IsEmpty())
-    {
-        g_deck.Reset();
-    }
-    return g_deck.Pop();
-}
-
-Game::pos Game::PickRandomTarget(EInputs dir)
-{
-    pos p;
-    switch (dir)
-    {
-        case EInputs::Left:
-        case EInputs::Right:
-        {
-            p.x = dir == EInputs::Left ? (BOARD_EXTENT - 1) : 0;
-            RandomPool<uint8_t, BOARD_EXTENT> y_pool;
-            for (int i = 0; i < anim.nMoving; ++i)
-            {
-                y_pool.PushUnique(anim.moving[i].from.y);
-            }
-            p.y = y_pool.Pick();
-        }
-        break;
-
-        case EInputs::Up:
-        case EInputs::Down:
-        {
-            p.y = dir == EInputs::Up ? (BOARD_EXTENT - 1) : 0;
-            RandomPool<uint8_t, BOARD_EXTENT> x_pool;
-            for (int i = 0; i < anim.nMoving; ++i)
-            {
-                x_pool.PushUnique(anim.moving[i].from.x);
-            }
-            p.x = x_pool.Pick();
-        }
-        break;
-        default: break;
-    }
-    return p;
+    return true;
 }
 
 Game::EInputs Game::ReadInput() const
@@ -666,12 +365,20 @@ bool Game::Update(EInputs input)
         Reset();
         stateChanged = true;
     }
+    else if (input == EInputs::Hint)
+    {
+        showHint = !showHint;
+        RefreshHint();
+        stateChanged = true;
+    }
 
     switch (phase)
     {
         case EPhases::Active:
             if (TryMoveBoard(input))
             {
+                // the stale search is dropped right away, the next one runs while the move animates
+                RefreshHint();
                 anim.alpha   = 0.0f;
                 phase        = EPhases::Animating;
                 stateChanged = true;
@@ -681,13 +388,10 @@ bool Game::Update(EInputs input)
             anim.alpha += TUI::GetDeltaSeconds() * (1.0f / cfg.animSeconds);
             if (anim.alpha > 1.0f)
             {
-                for (int i = 0; i < BOARD_SIZE; ++i)
-                {
-                    state.tiles[i] = anim.result[i] != 0 ? anim.result[i] : state.tiles[i];
-                }
+                state.packed = rules.board;
                 anim.Reset();
 
-                phase = IsGameOver() ? EPhases::GameOver : (IsGameWon() ? EPhases::GameWon : EPhases::Active);
+                phase = rules.IsGameOver() ? EPhases::GameOver : (rules.IsGameWon() ? EPhases::GameWon : EPhases::Active);
             }
             stateChanged = true;
             break;
@@ -704,29 +408,42 @@ bool Game::Update(EInputs input)
     return stateChanged;
 }
 
+void Game::RefreshHint()
+{
+    shownHint = HintEngine::Hint();
+    if (showHint && !rules.IsGameOver() && !rules.IsGameWon())
+        hints.SetPosition(rules.board, rules.next, rules.GetDeckState());
+    else
+        hints.Clear();
+}
+
 void Game::Draw() const
 {
     int w, h;
     TUI::GetSize(w, h);
     TUI::ClearScreen();
 
-    BoardRenderer::Render(cfg, state, anim, next);
+    BoardRenderer::Render(cfg, state, anim, rules.next);
 
     // Score
     {
-        uint score = 0;
-        for (int i = 0; i < BOARD_SIZE; ++i)
-        {
-            score += g_scores[(phase == EPhases::Animating && anim.result[i] > 0) ? anim.result[i] : state.tiles[i]];
-        }
+        const uint32_t score = rules.board.Score();
         BoardRenderer::rpos r = BoardRenderer::CalculateRenderPosition(cfg, Game::pos(5, 1));
         TUI::DrawText(r.x, r.y, "Score: %u", score);
     }
+    if (showHint && phase == EPhases::Active)
+    {
+        BoardRenderer::rpos r = BoardRenderer::CalculateRenderPosition(cfg, Game::pos(5, 2));
+        if (shownHint.move != EDirections::COUNT)
+            TUI::DrawText(r.x, r.y, "Hint: %s (depth %u)", g_directionNames[(int)shownHint.move], shownHint.depth);
+        else
+            TUI::DrawText(r.x, r.y, "Hint: thinking...");
+    }
 
     TUI::ColorScope nextTileTextColor(TUI::EColors::Black, TUI::EColors::LightGray);
     TUI::DrawLine(0, 0, w, 0);
     TUI::DrawText(1, 0, "Terminal Threes");
-    TUI::DrawText(w - 23, 0, "Restart (F5) | Quit (q)");
+    TUI::DrawText(w - (int)strlen(g_bindings), 0, g_bindings);
 
     if (phase == EPhases::GameOver ||
         phase == EPhases::GameWon)
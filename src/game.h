@@ -1,6 +1,8 @@
 #pragma once
 
 #include <stdint.h>
+#include <ai/hint.h>
+#include <core/threes.h>
 #include <util/pos2d.h>
 
 struct Game
@@ -28,6 +30,7 @@ struct Game
         Down,
         Space,
         Restart,
+        Hint,
         Quit,
 
         COUNT,
@@ -42,14 +45,14 @@ struct Game
         int tileHeight    = 5;
         int tileSpacing   = 1;
         float animSeconds = 0.25f;
+        uint8_t hintDepth = 6; // deepest search of the hint engine
     };
     struct Board
     {
-        Board();
+        inline uint8_t Get(uint8_t a_index) const { return packed.Get(a_index); }
+        inline void Set(uint8_t a_index, uint8_t a_value) { packed.Set(a_index, a_value); }
 
-        void Reset();
-
-        uint8_t tiles[BOARD_SIZE];
+        PackedBoard packed;
     };
     struct TileAnimation
     {
@@ -71,7 +74,6 @@ struct Game
     struct BoardAnimation
     {
         float alpha = 0.0f;
-        uint8_t result[BOARD_SIZE];
         TileAnimation moving[BOARD_SIZE + BOARD_EXTENT]; // impossible worst case: the entire board moves and a full row/column spawns
         uint8_t nMoving;
 
@@ -89,23 +91,23 @@ struct Game
 
 private:
     void Reset();
-    uint8_t CalculateTileMoveResult(pos a_from, pos a_to);
-    bool IsBoardMovePossible(EInputs dir);
-    bool IsGameOver();
-    bool IsGameWon();
+    static pos CalculateScanPosition(EInputs dir, int i);
+    static EDirections ToDirection(EInputs dir);
     pos CalculateMoveDiff(EInputs dir);
-    bool TryMoveTile(pos from, pos to);
     bool TryMoveBoard(EInputs dir);
-    uint8_t PickRandomValue();
-    pos PickRandomTarget(EInputs dir);
     EInputs ReadInput() const;
     bool Update(EInputs input);
+    // points the hint engine at the current position, or stops it if hints are off or the game has ended
+    void RefreshHint();
     void Draw() const;
 
     Config cfg;
-    Board state;
+    Threes rules;
+    Board state; // what is drawn as resting tiles, lags behind `rules` while animating
     BoardAnimation anim;
     EPhases phase = EPhases::Active;
-    uint8_t next;
+    HintEngine hints;
+    HintEngine::Hint shownHint;
+    bool showHint;
     bool quit;
 };
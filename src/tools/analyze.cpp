@@ -0,0 +1,298 @@
+#include <ai/expectimax.h>
+#include <core/archive.h>
+#include <core/replay.h>
+#include <core/threes.h>
+#include <util/threadpool.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <float.h>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+namespace
+{
+const char g_directionNames[(int)EDirections::COUNT] = { 'L', 'R', 'U', 'D' };
+
+struct Options
+{
+    const char* archive  = nullptr;
+    const char* outPath  = "-";
+    bool binary          = false;
+    uint64_t firstGame   = 0;
+    uint64_t games       = 0; // 0: to the end of the archive
+    int threads          = 0; // 0: one per core
+    uint8_t depth        = 2;
+    size_t ttBytes       = 16 << 20; // per thread
+    const char* progName = "tthrees_analyze";
+};
+
+// one move of one game. binary output is these fields as 20 little endian bytes: uint32 game, uint32 move,
+// uint8 played, uint8 best (0-3: left, right, up, down), 2 zero bytes, float best value, float loss
+struct MoveResult
+{
+    uint32_t move;
+    uint8_t played;
+    uint8_t best;
+    float bestValue;
+    float loss; // best value - value of the played move, 0 for a best move
+};
+const size_t g_binaryRecordSize = 20;
+
+struct GameSlot
+{
+    std::vector<MoveResult> moves;
+    bool damaged = false;
+    bool ready   = false;
+};
+
+// games are handed out in archive order and finish in any order; the writer takes them back in order through a
+// ring of slots. a worker only starts on a game once its slot is written out, which bounds the memory to the ring.
+struct Pipeline
+{
+    explicit Pipeline(size_t a_slots)
+        : slots(a_slots)
+        , written(0)
+    {
+    }
+
+    std::vector<GameSlot> slots;
+    uint64_t written; // games handed to the output so far
+    std::mutex mutex;
+    std::condition_variable changed;
+};
+
+void AnalyzeGame(Expectimax& a_solver, const Replay& a_replay, GameSlot& out_slot)
+{
+    out_slot.moves.clear();
+    out_slot.damaged = false;
+    ReplayReader reader(a_replay);
+    for (; !reader.IsDone(); reader.Next())
+    {
+        const Threes& game = reader.GetGame();
+        float values[(int)EDirections::COUNT];
+        const Expectimax::Result best = a_solver.EvaluateMoves(game.board, game.next, game.GetDeckState(), values);
+        const EDirections played      = reader.GetMove();
+        if (values[(int)played] == -FLT_MAX)
+        {
+            // not a legal move, the replay does not belong to these rules. the game is left out entirely
+            out_slot.damaged = true;
+            return;
+        }
+        MoveResult result;
+        result.move      = reader.GetMoveIndex();
+        result.played    = (uint8_t)played;
+        result.best      = (uint8_t)best.move;
+        result.bestValue = best.value;
+        result.loss      = best.value - values[(int)played];
+        out_slot.moves.push_back(result);
+    }
+}
+
+void WriteUInt32(uint8_t* out_bytes, uint32_t a_value)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        out_bytes[i] = (uint8_t)(a_value >> (8 * i));
+    }
+}
+
+void WriteFloat(uint8_t* out_bytes, float a_value)
+{
+    uint32_t bits;
+    memcpy(&bits, &a_value, sizeof(bits));
+    WriteUInt32(out_bytes, bits);
+}
+
+void WriteGame(FILE* a_file, bool a_binary, uint64_t a_game, const GameSlot& a_slot)
+{
+    for (const MoveResult& r : a_slot.moves)
+    {
+        if (a_binary)
+        {
+            uint8_t record[g_binaryRecordSize] = {};
+            WriteUInt32(record, (uint32_t)a_game);
+            WriteUInt32(record + 4, r.move);
+            record[8] = r.played;
+            record[9] = r.best;
+            WriteFloat(record + 12, r.bestValue);
+            WriteFloat(record + 16, r.loss);
+            fwrite(record, 1, sizeof(record), a_file);
+        }
+        else
+        {
+            fprintf(a_file, "%llu,%u,%c,%c,%.1f,%.1f\n", (unsigned long long)a_game, r.move, g_directionNames[r.played], g_directionNames[r.best],
+                    r.bestValue, r.loss);
+        }
+    }
+}
+
+int PrintUsage(const char* a_progName)
+{
+    fprintf(stderr, "usage: %s -a replays.ttra [-o moves.csv|-] [-b] [-s first game] [-n games] [-t threads] [-d depth] [-m tt MiB per thread]\n", a_progName);
+    return 1;
+}
+
+bool ParseOptions(int argc, char** argv, Options& out_opts)
+{
+    out_opts.progName = argv[0];
+    for (int i = 1; i < argc; ++i)
+    {
+        if (argv[i][0] != '-' || argv[i][1] == 0 || argv[i][2] != 0)
+        {
+            return false;
+        }
+        if (argv[i][1] == 'b')
+        {
+            out_opts.binary = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            return false;
+        }
+        const char* value = argv[++i];
+        switch (argv[i - 1][1])
+        {
+            case 'a': out_opts.archive = value; break;
+            case 'o': out_opts.outPath = value; break;
+            case 's': out_opts.firstGame = strtoull(value, nullptr, 10); break;
+            case 'n': out_opts.games = strtoull(value, nullptr, 10); break;
+            case 't': out_opts.threads = atoi(value); break;
+            case 'd': out_opts.depth = (uint8_t)atoi(value); break;
+            case 'm': out_opts.ttBytes = (size_t)atoi(value) << 20; break;
+            default: return false;
+        }
+    }
+    return out_opts.archive != nullptr && out_opts.depth > 0;
+}
+
+} // namespace
+
+// every move of every archived game against the best move of an expectimax search from the same position:
+// one line (or binary record) per move with the value the played move gave up
+int main(int argc, char** argv)
+{
+    Options opts;
+    if (!ParseOptions(argc, argv, opts))
+    {
+        return PrintUsage(opts.progName);
+    }
+    int threads = opts.threads > 0 ? opts.threads : (int)std::thread::hardware_concurrency();
+    if (threads < 1)
+        threads = 1;
+
+    ReplayArchive archive;
+    if (!archive.Open(opts.archive))
+    {
+        fprintf(stderr, "cannot read %s\n", opts.archive);
+        return 1;
+    }
+    const uint64_t first = opts.firstGame < archive.GetCount() ? opts.firstGame : archive.GetCount();
+    const uint64_t left  = archive.GetCount() - first;
+    const uint64_t games = opts.games > 0 && opts.games < left ? opts.games : left;
+
+    const bool toStdout = strcmp(opts.outPath, "-") == 0;
+    FILE* out           = toStdout ? stdout : fopen(opts.outPath, opts.binary ? "wb" : "w");
+    if (!out)
+    {
+        fprintf(stderr, "cannot open %s\n", opts.outPath);
+        return 1;
+    }
+    if (!opts.binary)
+        fprintf(out, "game,move,played,best,best_value,loss\n");
+
+    Expectimax::Config cfg;
+    cfg.depth   = opts.depth;
+    cfg.ttBytes = opts.ttBytes;
+    std::vector<std::unique_ptr<Expectimax>> solvers;
+    for (int i = 0; i < threads; ++i)
+    {
+        solvers.emplace_back(new Expectimax(cfg));
+    }
+
+    // a few games per thread in flight keeps every thread busy while the writer waits for the oldest one
+    Pipeline pipeline((size_t)threads * 8);
+    uint64_t moves   = 0;
+    uint64_t damaged = 0;
+    uint64_t nonBest = 0;
+    double lossSum   = 0.0;
+    std::thread writer([&]() {
+        for (uint64_t i = 0; i < games; ++i)
+        {
+            GameSlot& slot = pipeline.slots[i % pipeline.slots.size()];
+            {
+                std::unique_lock<std::mutex> lock(pipeline.mutex);
+                pipeline.changed.wait(lock, [&]() { return slot.ready; });
+            }
+            if (slot.damaged)
+            {
+                ++damaged;
+            }
+            else
+            {
+                WriteGame(out, opts.binary, first + i, slot);
+                moves += slot.moves.size();
+                for (const MoveResult& r : slot.moves)
+                {
+                    nonBest += r.loss > 0.0f ? 1 : 0;
+                    lossSum += r.loss;
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(pipeline.mutex);
+                slot.ready = false;
+                ++pipeline.written;
+            }
+            pipeline.changed.notify_all();
+        }
+    });
+
+    ThreadPool pool(threads);
+    const auto start = std::chrono::steady_clock::now();
+    pool.ParallelFor((size_t)games, [&](size_t a_index, int a_thread) {
+        GameSlot& slot = pipeline.slots[a_index % pipeline.slots.size()];
+        {
+            std::unique_lock<std::mutex> lock(pipeline.mutex);
+            pipeline.changed.wait(lock, [&]() { return a_index < pipeline.written + pipeline.slots.size(); });
+        }
+        Replay replay;
+        if (archive.Get(first + a_index, replay))
+        {
+            AnalyzeGame(*solvers[a_thread], replay, slot);
+        }
+        else
+        {
+            slot.moves.clear();
+            slot.damaged = true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(pipeline.mutex);
+            slot.ready = true;
+        }
+        pipeline.changed.notify_all();
+    });
+    writer.join();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bool ok = fflush(out) == 0;
+    if (!toStdout)
+        ok &= fclose(out) == 0;
+    if (!ok)
+    {
+        fprintf(stderr, "cannot write %s\n", opts.outPath);
+        return 1;
+    }
+    fprintf(stderr, "%llu games, %llu moves at depth %d on %d threads in %.2f s: %.0f moves/s\n", (unsigned long long)games, (unsigned long long)moves,
+            opts.depth, threads, seconds, moves / seconds);
+    fprintf(stderr, "loss: %.1f per move, %.1f per game, %.2f%% of the moves not the best\n", moves > 0 ? lossSum / moves : 0.0,
+            games > damaged ? lossSum / (games - damaged) : 0.0, moves > 0 ? 100.0 * nonBest / moves : 0.0);
+    if (damaged > 0)
+        fprintf(stderr, "%llu damaged games skipped\n", (unsigned long long)damaged);
+    return 0;
+}
@@ -0,0 +1,1141 @@
+#include <ai/expectimax.h>
+#include <ai/mcts.h>
+#include <ai/montecarlo.h>
+#include <ai/ntuple.h>
+#include <core/archive.h>
+#include <core/batch.h>
+#include <core/board.h>
+#include <core/replay.h>
+#include <core/threes.h>
+#include <util/threadpool.h>
+
+#define TUI_IMPLEMENTATION
+#define TUI_NO_PLATFORM
+#include <tui.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+namespace
+{
+// the per tile move scan Game::TryMoveBoard used before the line tables, kept as the baseline to compare against.
+struct LegacyBoard
+{
+    uint8_t tiles[PackedBoard::SIZE];
+    uint8_t result[PackedBoard::SIZE];
+
+    uint8_t CalculateTileMoveResult(int a_x, int a_y, int a_dx, int a_dy) const
+    {
+        const uint8_t from = tiles[a_y * PackedBoard::EXTENT + a_x];
+        const uint8_t to   = tiles[(a_y + a_dy) * PackedBoard::EXTENT + a_x + a_dx];
+        if ((from == 1 && to == 2) || (from == 2 && to == 1))
+            return 3;
+        else if (from != 0 && to == 0)
+            return from;
+        else if (from >= 3 && from == to)
+            return from + 1;
+        return 0;
+    }
+    bool TryMoveTile(int a_x, int a_y, int a_dx, int a_dy)
+    {
+        const uint8_t value = CalculateTileMoveResult(a_x, a_y, a_dx, a_dy);
+        if (value > 0)
+        {
+            result[(a_y + a_dy) * PackedBoard::EXTENT + a_x + a_dx] = value;
+            tiles[a_y * PackedBoard::EXTENT + a_x]                  = 0;
+            return true;
+        }
+        return false;
+    }
+    bool Move(EDirections a_dir)
+    {
+        const int n = PackedBoard::EXTENT;
+        bool any    = false;
+        memset(result, 0, sizeof(result));
+        switch (a_dir)
+        {
+            case EDirections::Left:
+                for (int x = 1; x < n; ++x)
+                    for (int y = 0; y < n; ++y)
+                        any |= TryMoveTile(x, y, -1, 0);
+                break;
+            case EDirections::Right:
+                for (int x = n - 2; x >= 0; --x)
+                    for (int y = 0; y < n; ++y)
+                        any |= TryMoveTile(x, y, +1, 0);
+                break;
+            case EDirections::Up:
+                for (int x = 0; x < n; ++x)
+                    for (int y = 1; y < n; ++y)
+                        any |= TryMoveTile(x, y, 0, -1);
+                break;
+            case EDirections::Down:
+                for (int x = 0; x < n; ++x)
+                    for (int y = n - 2; y >= 0; --y)
+                        any |= TryMoveTile(x, y, 0, +1);
+                break;
+            default: break;
+        }
+        for (int i = 0; i < PackedBoard::SIZE; ++i)
+        {
+            if (result[i] != 0)
+                tiles[i] = result[i];
+        }
+        return any;
+    }
+};
+
+struct XorShift
+{
+    uint64_t state;
+
+    uint32_t Next()
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return (uint32_t)(state >> 32);
+    }
+};
+
+// mid game like boards: mostly small tiles, a few large ones and some gaps
+std::vector<PackedBoard> GenerateBoards(size_t a_count)
+{
+    XorShift rng = { 0x9E3779B97F4A7C15ULL };
+    std::vector<PackedBoard> boards(a_count);
+    for (PackedBoard& board : boards)
+    {
+        for (uint8_t i = 0; i < PackedBoard::SIZE; ++i)
+        {
+            const uint32_t roll = rng.Next() % 16;
+            board.Set(i, (uint8_t)(roll < 3 ? 0 : (roll < 12 ? 1 + rng.Next() % 4 : 3 + rng.Next() % 9)));
+        }
+    }
+    return boards;
+}
+
+template <typename F>
+double MeasureMovesPerSecond(size_t a_moves, F a_func)
+{
+    const auto start = std::chrono::steady_clock::now();
+    a_func();
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return a_moves / seconds;
+}
+
+int BenchMoves()
+{
+    const size_t boardCount = 1 << 16;
+    const int rounds        = 64;
+    const size_t moveCount  = boardCount * rounds * (size_t)EDirections::COUNT;
+
+    const std::vector<PackedBoard> boards = GenerateBoards(boardCount);
+    std::vector<LegacyBoard> legacy(boardCount);
+    for (size_t i = 0; i < boardCount; ++i)
+    {
+        for (uint8_t t = 0; t < PackedBoard::SIZE; ++t)
+        {
+            legacy[i].tiles[t] = boards[i].Get(t);
+        }
+    }
+
+    // both implementations have to agree before their speed means anything
+    for (size_t i = 0; i < boardCount; ++i)
+    {
+        for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+        {
+            PackedBoard packed        = boards[i];
+            LegacyBoard reference     = legacy[i];
+            const bool movedPacked    = packed.Move((EDirections)dir);
+            const bool movedReference = reference.Move((EDirections)dir);
+            bool same                 = movedPacked == movedReference;
+            for (uint8_t t = 0; t < PackedBoard::SIZE; ++t)
+            {
+                same &= packed.Get(t) == reference.tiles[t];
+            }
+            if (!same)
+            {
+                fprintf(stderr, "mismatch: board %zu, direction %d\n", i, (int)dir);
+                return 1;
+            }
+        }
+    }
+
+    uint64_t checksum       = 0;
+    const double legacyRate = MeasureMovesPerSecond(moveCount, [&]() {
+        for (int r = 0; r < rounds; ++r)
+        {
+            for (size_t i = 0; i < boardCount; ++i)
+            {
+                for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+                {
+                    LegacyBoard board = legacy[i];
+                    checksum += board.Move((EDirections)dir) ? board.tiles[r % PackedBoard::SIZE] : 0;
+                }
+            }
+        }
+    });
+    const double packedRate = MeasureMovesPerSecond(moveCount, [&]() {
+        for (int r = 0; r < rounds; ++r)
+        {
+            for (size_t i = 0; i < boardCount; ++i)
+            {
+                for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+                {
+                    PackedBoard board = boards[i];
+                    checksum += board.Move((EDirections)dir) ? board.lo : 0;
+                }
+            }
+        }
+    });
+
+    printf("moves: per tile scan %12.0f moves/s\n", legacyRate);
+    printf("moves: line tables   %12.0f moves/s (x%.1f)\n", packedRate, packedRate / legacyRate);
+    printf("(checksum %llu)\n", (unsigned long long)checksum);
+    return 0;
+}
+
+// the structure of arrays kernels against PackedBoard::Move, one direction for all boards per call
+int BenchBatch()
+{
+    const size_t boardCount = 1 << 16;
+    const int rounds        = 64;
+    const size_t moveCount  = boardCount * rounds * (size_t)EDirections::COUNT;
+
+    std::vector<PackedBoard> boards = GenerateBoards(boardCount);
+    // every other board without gaps, so the game over check sees both outcomes
+    for (size_t i = 0; i < boardCount; i += 2)
+    {
+        for (uint8_t t = 0; t < PackedBoard::SIZE; ++t)
+        {
+            if (boards[i].Get(t) == 0)
+                boards[i].Set(t, (uint8_t)(3 + (i + t) % 13));
+        }
+    }
+    BoardBatch batch(boardCount);
+    for (size_t i = 0; i < boardCount; ++i)
+    {
+        batch.SetBoard(i, boards[i]);
+    }
+
+    std::vector<uint16_t> moved(batch.GetCount());
+    std::vector<uint8_t> changed(batch.GetCount());
+    std::vector<uint8_t> gameOver(batch.GetCount());
+    batch.CalculateGameOver(gameOver.data());
+    for (size_t i = 0; i < boardCount; ++i)
+    {
+        if ((gameOver[i] != 0) != boards[i].IsGameOver())
+        {
+            fprintf(stderr, "mismatch: board %zu, game over\n", i);
+            return 1;
+        }
+    }
+    for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+    {
+        BoardBatch moving = batch;
+        moving.Move((EDirections)dir, moved.data(), changed.data());
+        for (size_t i = 0; i < boardCount; ++i)
+        {
+            PackedBoard reference = boards[i];
+            uint16_t referenceMoved;
+            const bool referenceChanged = reference.Move((EDirections)dir, &referenceMoved);
+            if (moving.GetBoard(i) != reference || moved[i] != referenceMoved || (changed[i] != 0) != referenceChanged)
+            {
+                fprintf(stderr, "mismatch: board %zu, direction %d\n", i, (int)dir);
+                return 1;
+            }
+        }
+    }
+
+    uint64_t checksum       = 0;
+    const double packedRate = MeasureMovesPerSecond(moveCount, [&]() {
+        for (int r = 0; r < rounds; ++r)
+        {
+            for (size_t i = 0; i < boardCount; ++i)
+            {
+                for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+                {
+                    PackedBoard board = boards[i];
+                    uint16_t mask;
+                    checksum += board.Move((EDirections)dir, &mask) ? mask : 0;
+                }
+            }
+        }
+    });
+    // the boards keep moving instead of being restored, which costs the kernels nothing extra
+    const double batchRate = MeasureMovesPerSecond(moveCount, [&]() {
+        for (int r = 0; r < rounds; ++r)
+        {
+            for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+            {
+                batch.Move((EDirections)dir, moved.data(), changed.data());
+                checksum += moved[r];
+            }
+        }
+    });
+    const double gameOverRate = MeasureMovesPerSecond(boardCount * rounds, [&]() {
+        for (int r = 0; r < rounds; ++r)
+        {
+            batch.CalculateGameOver(gameOver.data());
+            checksum += gameOver[r];
+        }
+    });
+
+    printf("batch: line tables   %12.0f moves/s\n", packedRate);
+    printf("batch: %-6s kernel  %12.0f moves/s (x%.1f), %.0f game over checks/s\n", BoardBatch::KERNEL, batchRate, batchRate / packedRate, gameOverRate);
+    printf("(checksum %llu)\n", (unsigned long long)checksum);
+    return 0;
+}
+
+// complete games with uniformly random moves through the headless rules
+int BenchGames()
+{
+    const uint32_t gameCount = 20000;
+    XorShift rng             = { 0x2545F4914F6CDD1DULL };
+    uint64_t moves           = 0;
+    uint64_t checksum        = 0;
+    const auto start         = std::chrono::steady_clock::now();
+    for (uint32_t seed = 0; seed < gameCount; ++seed)
+    {
+        Threes game(seed);
+        while (!game.IsGameOver() && !game.IsGameWon())
+        {
+            if (game.Move((EDirections)(rng.Next() % (uint32_t)EDirections::COUNT)))
+            {
+                ++moves;
+            }
+        }
+        checksum += game.board.Score();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("games: %12.0f games/s, %.0f moves/s, %.1f moves/game\n", gameCount / seconds, moves / seconds, (double)moves / gameCount);
+    printf("(checksum %llu)\n", (unsigned long long)checksum);
+    return 0;
+}
+
+// a game with uniformly random moves, out_game is left at its end
+Replay PlayRandomReplay(uint32_t a_seed, XorShift& a_rng, Threes& out_game)
+{
+    Replay replay(a_seed);
+    out_game = Threes(a_seed);
+    while (!out_game.IsGameOver() && !out_game.IsGameWon())
+    {
+        const EDirections dir = (EDirections)(a_rng.Next() % (uint32_t)EDirections::COUNT);
+        if (out_game.Move(dir))
+            replay.Push(dir);
+    }
+    return replay;
+}
+
+// random games recorded as replays, stored and played back through the rules, against storing every position
+int BenchReplay()
+{
+    const uint32_t gameCount = 20000;
+    XorShift rng             = { 0x2545F4914F6CDD1DULL };
+    std::vector<uint8_t> archive;
+    std::vector<uint64_t> scores;
+    uint64_t moves = 0;
+    for (uint32_t seed = 0; seed < gameCount; ++seed)
+    {
+        Threes game(seed);
+        const Replay replay = PlayRandomReplay(seed, rng, game);
+        const size_t offset = archive.size();
+        archive.resize(offset + replay.GetSerializedSize());
+        replay.Serialize(archive.data() + offset);
+        scores.push_back(game.board.Score());
+        moves += replay.GetMoveCount();
+    }
+
+    uint32_t mismatches = 0;
+    size_t offset       = 0;
+    Replay replay;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < gameCount; ++i)
+    {
+        size_t used = 0;
+        Threes game(0);
+        if (!replay.Deserialize(archive.data() + offset, archive.size() - offset, &used) || !replay.Play(game) ||
+            game.board.Score() != scores[i])
+        {
+            ++mismatches;
+        }
+        offset += used;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const double snapshotBytes = (double)(moves + gameCount) * (sizeof(PackedBoard) + 1 + sizeof(Threes::DeckState));
+    printf("replay: %.1f bytes/game, %.3f bytes/move (every position: %.0f bytes/game, x%.0f)\n", (double)archive.size() / gameCount,
+           (double)archive.size() / moves, snapshotBytes / gameCount, snapshotBytes / archive.size());
+    printf("replay: %12.0f games/s, %.0f moves/s played back, %u mismatches\n", gameCount / seconds, moves / seconds, mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// random games appended to an archive file in two sessions, then random access and a full scan played through the rules
+int BenchArchive(uint32_t a_games, int a_threads)
+{
+    const char* path = "tthrees_bench.ttra";
+    remove(path);
+    XorShift rng          = { 0x2545F4914F6CDD1DULL };
+    uint64_t scoreSum     = 0;
+    uint64_t moves        = 0;
+    const auto writeStart = std::chrono::steady_clock::now();
+    for (uint32_t half = 0; half < 2; ++half)
+    {
+        ReplayArchiveWriter writer;
+        if (!writer.Open(path) || writer.GetCount() != half * (a_games / 2))
+        {
+            fprintf(stderr, "archive: cannot open %s for appending\n", path);
+            return 1;
+        }
+        const uint32_t last = half == 0 ? a_games / 2 : a_games;
+        for (uint32_t seed = writer.GetCount(); seed < last; ++seed)
+        {
+            Threes game(seed);
+            const Replay replay = PlayRandomReplay(seed, rng, game);
+            scoreSum += game.board.Score();
+            moves += replay.GetMoveCount();
+            writer.Append(replay);
+        }
+        if (!writer.Close())
+        {
+            fprintf(stderr, "archive: cannot write %s\n", path);
+            return 1;
+        }
+    }
+    const double writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - writeStart).count();
+
+    ReplayArchive archive;
+    if (!archive.Open(path) || archive.GetCount() != a_games)
+    {
+        fprintf(stderr, "archive: cannot read %s\n", path);
+        return 1;
+    }
+    FILE* file = fopen(path, "rb");
+    fseek(file, 0, SEEK_END);
+    const long fileSize = ftell(file);
+    fclose(file);
+
+    // game N was recorded with seed N
+    const uint32_t lookups = 1000000;
+    uint32_t mismatches    = 0;
+    Replay replay;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < lookups; ++i)
+    {
+        const uint32_t index = (uint32_t)(rng.Next() % a_games);
+        if (!archive.Get(index, replay) || replay.GetSeed() != index)
+            ++mismatches;
+    }
+    const double lookupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("archive: %u games, %.1f bytes/game on disk, written at %.0f games/s (in 2 sessions)\n", a_games, (double)fileSize / a_games, a_games / writeSeconds);
+    printf("archive: %12.0f random lookups/s\n", lookups / lookupSeconds);
+    const int threadCounts[2] = { 1, a_threads };
+    for (int run = 0; run < (a_threads > 1 ? 2 : 1); ++run)
+    {
+        const int threads = threadCounts[run];
+        ThreadPool pool(threads);
+        std::vector<uint64_t> scores(threads, 0);
+        std::vector<uint64_t> scanned(threads, 0);
+        start                  = std::chrono::steady_clock::now();
+        const uint64_t damaged = archive.ParallelScan(pool, [&](uint64_t a_index, const Replay& a_replay, int a_thread) {
+            Threes game(0);
+            if (a_replay.GetSeed() == a_index && a_replay.Play(game))
+                scores[a_thread] += game.board.Score();
+            ++scanned[a_thread];
+        });
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t score       = 0;
+        uint64_t games       = 0;
+        for (int i = 0; i < threads; ++i)
+        {
+            score += scores[i];
+            games += scanned[i];
+        }
+        if (games != a_games || score != scoreSum)
+            ++mismatches;
+        printf("archive: %d threads %12.0f games/s, %.0f moves/s played back, %llu damaged\n", threads, games / seconds, moves / seconds, (unsigned long long)damaged);
+    }
+    archive.Close();
+    remove(path);
+    printf("(%u mismatches)\n", mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// the game screen: header line, board with grid, 16 tiles of 8x5 cells of which a_moving slide by (a_dx, a_dy)
+void DrawGameScreen(int a_moving, int a_dx, int a_dy, uint32_t a_score)
+{
+    int w, h;
+    TUI::GetSize(w, h);
+    TUI::ClearScreen();
+    TUI::DrawRect(TUI::Color(TUI::EColors::White, TUI::EColors::DarkGray), 3, 3, 36, 24);
+    TUI::ColorScope gridColor(TUI::EColors::White, TUI::EColors::Black);
+    for (int i = 0; i <= 4; ++i)
+    {
+        TUI::DrawLine(2, 2 + 6 * i, 38, 2 + 6 * i);
+        TUI::DrawLine(2 + 9 * i, 2, 2 + 9 * i, 26);
+    }
+    for (int i = 0; i < 16; ++i)
+    {
+        const int x = 3 + 9 * (i % 4) + (i < a_moving ? a_dx : 0);
+        const int y = 3 + 6 * (i / 4) + (i < a_moving ? a_dy : 0);
+        TUI::DrawRect(TUI::Color(TUI::EColors::Black, TUI::EColors::LightGray), x, y, 8, 5);
+        TUI::DrawText(TUI::Color(TUI::EColors::Black, TUI::EColors::LightGray), x, y + 2, "   %d", 3 << (i % 5));
+    }
+    TUI::DrawText(48, 9, "Score: %u", a_score);
+    TUI::ColorScope headerColor(TUI::EColors::Black, TUI::EColors::LightGray);
+    TUI::DrawLine(0, 0, w, 0);
+    TUI::DrawText(1, 0, "Terminal Threes");
+}
+
+// bytes a terminal gets for a cursor move and for a color change, as plain ANSI sequences
+int CursorBytes(int a_x, int a_y)
+{
+    return snprintf(nullptr, 0, "\033[%d;%dH", a_y + 1, a_x + 1);
+}
+
+int ColorBytes(uint8_t a_color)
+{
+    const TUI::Color color(a_color);
+    const int fg = (int)color.foreground;
+    const int bg = (int)color.background;
+    return snprintf(nullptr, 0, "\033[%d;%dm", fg < 8 ? 30 + fg : 82 + fg, bg < 8 ? 40 + bg : 92 + bg);
+}
+
+// cells EndFrame compares per frame on a large terminal: a move (horizontal and vertical in turn) animates for
+// 15 frames, then the screen idles.
+// the output of the animated frames is counted as positioned writes and the bytes of an escape stream for them,
+// once with a write per changed cell and once with a write per run of adjacent cells of one color
+int BenchScreen(int a_width, int a_height)
+{
+    TUI_Shared::Buffer cache;
+    TUI_Shared::g_consoleData.Resize((uint16_t)a_width, (uint16_t)a_height);
+    DrawGameScreen(0, 0, 0, 0);
+    TUI_Shared::PresentDirty(TUI_Shared::g_consoleData, cache, [](int, int, const TUI_Shared::Cell&) {});
+
+    const int animFrames = 15;
+    const int idleFrames = 45;
+    const int moves      = 100;
+    uint64_t animVisited = 0;
+    uint64_t idleVisited = 0;
+    uint64_t changed     = 0;
+    uint64_t runs        = 0;
+    uint64_t colors      = 0;
+    uint64_t cellBytes   = 0;
+    uint64_t runBytes    = 0;
+    int activeColor      = -1;
+    for (int move = 0; move < moves; ++move)
+    {
+        for (int frame = 1; frame <= animFrames; ++frame)
+        {
+            // the last frame puts every tile back in its cell, like the game once the move is done
+            const int offset = frame < animFrames ? frame * (move % 2 == 0 ? 9 : 6) / animFrames : 0;
+            DrawGameScreen(4 + move % 12, move % 2 == 0 ? offset : 0, move % 2 == 0 ? 0 : offset, move);
+            animVisited += TUI_Shared::PresentRuns(TUI_Shared::g_consoleData, cache, [&](int a_x, int a_y, uint8_t a_color, const char*, int a_length) {
+                const int colorBytes = a_color != activeColor ? ColorBytes(a_color) : 0;
+                colors += a_color != activeColor ? 1 : 0;
+                activeColor = a_color;
+                for (int i = 0; i < a_length; ++i)
+                {
+                    cellBytes += CursorBytes(a_x + i, a_y) + 1;
+                }
+                cellBytes += colorBytes;
+                runBytes += CursorBytes(a_x, a_y) + a_length + colorBytes;
+                changed += a_length;
+                ++runs;
+            });
+        }
+        for (int frame = 0; frame < idleFrames; ++frame)
+        {
+            idleVisited += TUI_Shared::PresentDirty(TUI_Shared::g_consoleData, cache, [&](int, int, const TUI_Shared::Cell&) { ++changed; });
+        }
+    }
+    const double cells  = (double)a_width * a_height;
+    const double frames = (double)moves * animFrames;
+    printf("screen: %dx%d, %d moves of %d animated and %d idle frames\n", a_width, a_height, moves, animFrames, idleFrames);
+    printf("screen: animated %8.0f cells visited/frame (full scan %.0f, x%.1f), %.0f changed\n", animVisited / frames, cells, cells * frames / animVisited,
+           changed / frames);
+    printf("screen: idle     %8.0f cells visited/frame (full scan %.0f)\n", (double)idleVisited / (moves * idleFrames), cells);
+    printf("screen: animated output per cell %6.0f writes, %6.0f bytes/frame\n", changed / frames + colors / frames, cellBytes / frames);
+    printf("screen: animated output per run  %6.0f writes, %6.0f bytes/frame (x%.1f)\n", runs / frames + colors / frames, runBytes / frames,
+           (double)cellBytes / runBytes);
+    return 0;
+}
+
+// FrameTimer::EndFrame before deadlines: the rest of the frame cut to whole milliseconds, slept relative to now
+void LegacyEndFrame(std::chrono::steady_clock::time_point a_frameStart, int a_targetFps)
+{
+    const double targetMs                                   = 1000.0 / a_targetFps;
+    std::chrono::duration<double, std::milli> frameDuration = std::chrono::steady_clock::now() - a_frameStart;
+    if (frameDuration.count() < targetMs)
+        std::this_thread::sleep_for(std::chrono::milliseconds((int)(targetMs - frameDuration.count())));
+}
+
+int BenchPacing(int a_frames, int a_fps)
+{
+    // a little work per frame, like drawing the board
+    auto work = []() {
+        const auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(500);
+        while (std::chrono::steady_clock::now() < until)
+        {
+        }
+    };
+
+    std::vector<float> legacy;
+    auto last = std::chrono::steady_clock::now();
+    for (int i = 0; i < a_frames; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        work();
+        LegacyEndFrame(start, a_fps);
+        const auto now = std::chrono::steady_clock::now();
+        legacy.push_back(std::chrono::duration<float, std::milli>(now - last).count());
+        last = now;
+    }
+    std::sort(legacy.begin(), legacy.end());
+
+    const auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < a_frames; ++i)
+    {
+        TUI_Shared::g_frameTimer.BeginFrame();
+        work();
+        TUI_Shared::g_frameTimer.EndFrame(a_fps);
+    }
+    const double seconds        = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    const TUI::FrameStats stats = TUI::GetFrameStats();
+
+    const size_t n  = legacy.size();
+    float legacySum = 0.0f;
+    for (float ms : legacy)
+        legacySum += ms;
+    printf("pacing: %d frames at %d fps, target %.2f ms\n", a_frames, a_fps, 1000.0 / a_fps);
+    printf("pacing: relative ms sleep  %6.2f fps, frame min %.2f p50 %.2f p99 %.2f max %.2f ms\n", 1000.0 * n / legacySum, legacy[0], legacy[(n - 1) / 2],
+           legacy[(n - 1) * 99 / 100], legacy[n - 1]);
+    printf("pacing: absolute deadline  %6.2f fps, frame min %.2f p50 %.2f p99 %.2f max %.2f ms\n", a_frames / seconds, stats.minMs, stats.p50Ms, stats.p99Ms,
+           stats.maxMs);
+    return 0;
+}
+
+struct Position
+{
+    PackedBoard board;
+    uint8_t next;
+    Threes::DeckState deck;
+};
+
+// positions from random games, sampled every few moves so early, mid and late game boards are all present
+std::vector<Position> GeneratePositions(size_t a_count)
+{
+    XorShift rng = { 0x5DEECE66DULL };
+    std::vector<Position> positions;
+    for (uint32_t seed = 0; positions.size() < a_count; ++seed)
+    {
+        Threes game(seed);
+        for (int move = 0; !game.IsGameOver() && positions.size() < a_count; ++move)
+        {
+            if (move % 7 == 3)
+            {
+                Position p = { game.board, game.next, game.GetDeckState() };
+                positions.push_back(p);
+            }
+            while (!game.Move((EDirections)(rng.Next() % (uint32_t)EDirections::COUNT)))
+            {
+            }
+        }
+    }
+    return positions;
+}
+
+int BenchSolver(int a_depth, int a_ttMegabytes, int a_threads)
+{
+    const std::vector<Position> positions = GeneratePositions(200);
+
+    Expectimax::Config cfg;
+    cfg.depth   = (uint8_t)a_depth;
+    cfg.ttBytes = (size_t)a_ttMegabytes << 20;
+    cfg.threads = a_threads;
+    Expectimax solver(cfg);
+
+    uint64_t nodes    = 0;
+    uint64_t ttHits   = 0;
+    uint64_t ttProbes = 0;
+    double seconds    = 0.0;
+    double value      = 0.0;
+    std::vector<Expectimax::Result> results;
+    for (const Position& p : positions)
+    {
+        const Expectimax::Result result = solver.Search(p.board, p.next, p.deck);
+        nodes += result.nodes;
+        ttHits += result.ttHits;
+        ttProbes += result.ttProbes;
+        seconds += result.seconds;
+        value += result.value;
+        results.push_back(result);
+    }
+
+    printf("solver: depth %d, %d threads, %zu positions, %.3f s, %.0f nodes/s, %.0f nodes/position\n", a_depth, a_threads, positions.size(), seconds, nodes / seconds, (double)nodes / positions.size());
+    printf("solver: transposition table %.1f MiB, hit rate %.1f%%\n", solver.GetTranspositionTable().GetMemorySize() / (1024.0 * 1024.0), ttProbes > 0 ? 100.0 * ttHits / ttProbes : 0.0);
+    printf("(mean value %.1f)\n", value / positions.size());
+
+    {
+        // the same searches without counting cards: every chance node branches over all tile values
+        Expectimax blind(cfg);
+        uint64_t blindNodes = 0;
+        for (const Position& p : positions)
+        {
+            blindNodes += blind.Search(p.board, p.next).nodes;
+        }
+        printf("solver: unknown deck %.0f nodes/position, the deck saves %.1f%%\n", (double)blindNodes / positions.size(), blindNodes > 0 ? 100.0 * (1.0 - (double)nodes / blindNodes) : 0.0);
+    }
+    {
+        // and without folding symmetric boards into one table entry
+        cfg.symmetry = false;
+        Expectimax unfolded(cfg);
+        cfg.symmetry         = true;
+        uint64_t plainNodes  = 0;
+        uint64_t plainHits   = 0;
+        uint64_t plainProbes = 0;
+        double plainSeconds  = 0.0;
+        for (const Position& p : positions)
+        {
+            const Expectimax::Result result = unfolded.Search(p.board, p.next, p.deck);
+            plainSeconds += result.seconds;
+            plainNodes += result.nodes;
+            plainHits += result.ttHits;
+            plainProbes += result.ttProbes;
+        }
+        printf("solver: without symmetries %.3f s, %.0f nodes/position, hit rate %.1f%%\n", plainSeconds, (double)plainNodes / positions.size(), plainProbes > 0 ? 100.0 * plainHits / plainProbes : 0.0);
+    }
+
+    if (a_threads > 1)
+    {
+        // the parallel search has to pick exactly what a single thread would
+        cfg.threads = 1;
+        Expectimax serial(cfg);
+        double serialSeconds = 0.0;
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            const Expectimax::Result result = serial.Search(positions[i].board, positions[i].next, positions[i].deck);
+            serialSeconds += result.seconds;
+            if (result.move != results[i].move || result.value != results[i].value)
+            {
+                fprintf(stderr, "mismatch: position %zu, serial %d (%f), parallel %d (%f)\n", i, (int)result.move, result.value, (int)results[i].move, results[i].value);
+                return 1;
+            }
+        }
+        printf("solver: 1 thread %.3f s, speedup x%.2f\n", serialSeconds, serialSeconds / seconds);
+    }
+    return 0;
+}
+
+// iterative deepening against a per move deadline: how deep it gets and how far the latency overshoots
+int BenchDeadline(int a_milliseconds, int a_maxDepth, int a_threads)
+{
+    const std::vector<Position> positions = GeneratePositions(200);
+
+    Expectimax::Config cfg;
+    cfg.depth     = (uint8_t)a_maxDepth;
+    cfg.timeLimit = (uint32_t)a_milliseconds;
+    cfg.threads   = a_threads;
+    Expectimax solver(cfg);
+
+    uint32_t depths[256] = {};
+    std::vector<double> latencies;
+    uint64_t nodes = 0;
+    int timeouts   = 0;
+    for (const Position& p : positions)
+    {
+        const Expectimax::Result result = solver.Search(p.board, p.next, p.deck);
+        ++depths[result.depth];
+        latencies.push_back(result.seconds * 1000.0);
+        nodes += result.nodes;
+        timeouts += result.timedOut ? 1 : 0;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    printf("deadline: %d ms, depth <= %d, %d threads, %zu positions, %.0f nodes/position, %d cut short\n", a_milliseconds, a_maxDepth, a_threads, positions.size(), (double)nodes / positions.size(), timeouts);
+    printf("deadline: latency p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100], latencies.back());
+    printf("deadline: depth reached");
+    for (int d = 1; d <= a_maxDepth; ++d)
+    {
+        if (depths[d] > 0)
+            printf(" %d:%u", d, depths[d]);
+    }
+    printf("\n");
+    return 0;
+}
+
+// the value of every legal move at a_solver's depth + 1, -1 for illegal ones
+void CalculateMoveValues(Expectimax& a_solver, const Position& a_position, float* out_values)
+{
+    for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+    {
+        out_values[dir]        = -1.0f;
+        PackedBoard afterstate = a_position.board;
+        uint16_t moved;
+        if (!afterstate.Move((EDirections)dir, &moved))
+        {
+            continue;
+        }
+        const uint8_t lines = PackedBoard::MovedLines((EDirections)dir, moved);
+        float sum           = 0.0f;
+        int n               = 0;
+        for (uint8_t line = 0; line < PackedBoard::EXTENT; ++line)
+        {
+            if ((lines & (1 << line)) == 0)
+            {
+                continue;
+            }
+            PackedBoard board = afterstate;
+            board.Set(PackedBoard::SpawnIndex((EDirections)dir, line), a_position.next);
+            Threes::TileChance chances[Threes::MAX_TILE_CHANCES];
+            const uint8_t count = Threes::CalculateTileChances(board, a_position.deck, chances);
+            float value         = 0.0f;
+            for (uint8_t i = 0; i < count; ++i)
+            {
+                value += chances[i].probability * a_solver.Search(board, chances[i].value, a_position.deck.Drawn(chances[i].value)).value;
+            }
+            sum += value;
+            ++n;
+        }
+        out_values[dir] = sum / n;
+    }
+}
+
+// pruned searches against the exact values of all moves: time saved and value lost by worse choices
+int BenchPruning(int a_depth)
+{
+    if (a_depth < 2)
+    {
+        fprintf(stderr, "pruning: needs a depth of at least 2\n");
+        return 1;
+    }
+    const std::vector<Position> positions = GeneratePositions(200);
+
+    Expectimax::Config exactCfg;
+    exactCfg.depth = (uint8_t)(a_depth - 1);
+    Expectimax exact(exactCfg);
+    std::vector<float> values(positions.size() * (int)EDirections::COUNT);
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        CalculateMoveValues(exact, positions[i], &values[i * (int)EDirections::COUNT]);
+    }
+
+    struct Variant
+    {
+        const char* name;
+        float cutoff;
+        bool star1;
+    };
+    const Variant variants[] = {
+        { "none", 0.0f, false },
+        { "star1", 0.0f, true },
+        { "cutoff 1e-4", 1e-4f, false },
+        { "cutoff 1e-3", 1e-3f, false },
+        { "cutoff 1e-2", 1e-2f, false },
+        { "star1 + cutoff 1e-3", 1e-3f, true },
+    };
+    double baseSeconds = 0.0;
+    for (const Variant& variant : variants)
+    {
+        Expectimax::Config cfg;
+        cfg.depth  = (uint8_t)a_depth;
+        cfg.cutoff = variant.cutoff;
+        cfg.star1  = variant.star1;
+        Expectimax solver(cfg);
+
+        uint64_t nodes = 0;
+        double seconds = 0.0;
+        double loss    = 0.0;
+        float maxLoss  = 0.0f;
+        int worse      = 0;
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            const Expectimax::Result result = solver.Search(positions[i].board, positions[i].next, positions[i].deck);
+            nodes += result.nodes;
+            seconds += result.seconds;
+
+            const float* moveValues = &values[i * (int)EDirections::COUNT];
+            float best              = -1.0f;
+            for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+            {
+                best = moveValues[dir] > best ? moveValues[dir] : best;
+            }
+            const float chosen = result.move != EDirections::COUNT ? moveValues[(int)result.move] : best;
+            if (chosen < best)
+            {
+                ++worse;
+                loss += best - chosen;
+                maxLoss = best - chosen > maxLoss ? best - chosen : maxLoss;
+            }
+        }
+        if (baseSeconds == 0.0)
+            baseSeconds = seconds;
+        printf("pruning: %-20s %.3f s, x%.2f, %9.0f nodes/position, %3d worse moves, mean loss %.1f, max loss %.1f\n", variant.name, seconds, baseSeconds / seconds, (double)nodes / positions.size(), worse, loss / positions.size(), maxLoss);
+    }
+    return 0;
+}
+
+// monte carlo move choices along random games, early stopping included
+int BenchRollouts(int a_playouts, int a_threads)
+{
+    MonteCarlo::Config cfg;
+    cfg.playouts = (uint32_t)a_playouts;
+    cfg.threads  = a_threads;
+    MonteCarlo chooser(cfg);
+
+    XorShift rng      = { 0x3C6EF372FE94F82BULL };
+    uint64_t playouts = 0;
+    uint64_t moves    = 0;
+    double seconds    = 0.0;
+    int searches      = 0;
+    int earlyStops    = 0;
+    for (uint32_t seed = 0; seed < 20; ++seed)
+    {
+        Threes game(seed);
+        for (int move = 0; move < 60 && !game.IsGameOver(); ++move)
+        {
+            if (move % 10 == 5)
+            {
+                const MonteCarlo::Result result = chooser.Search(game);
+                playouts += result.playouts;
+                moves += result.moves;
+                seconds += result.seconds;
+                ++searches;
+                earlyStops += result.stoppedEarly ? 1 : 0;
+            }
+            while (!game.Move((EDirections)(rng.Next() % (uint32_t)EDirections::COUNT)))
+            {
+            }
+        }
+    }
+
+    printf("rollouts: %d searches, %d threads, %.3f s, %.0f playouts/s, %.0f moves/s\n", searches, a_threads, seconds, playouts / seconds, moves / seconds);
+    printf("rollouts: %.0f playouts/search (at most %d per move), %d searches stopped early\n", (double)playouts / searches, a_playouts, earlyStops);
+    return 0;
+}
+
+// tree search along its own games, so the reuse of subtrees between moves shows up as well
+int BenchTree(int a_iterations)
+{
+    MCTS::Config cfg;
+    cfg.iterations = (uint32_t)a_iterations;
+    MCTS tree(cfg);
+
+    uint64_t nodes    = 0;
+    uint64_t visits   = 0;
+    uint64_t reused   = 0;
+    double seconds    = 0.0;
+    double bytes      = 0.0;
+    double treeNodes  = 0.0;
+    uint64_t score    = 0;
+    uint32_t searches = 0;
+    for (uint32_t seed = 0; seed < 4; ++seed)
+    {
+        Threes game(seed);
+        tree.Reset(seed);
+        for (int move = 0; move < 100 && !game.IsGameOver(); ++move)
+        {
+            const MCTS::Result result = tree.Search(game.board, game.next, game.GetDeckState());
+            nodes += result.nodes;
+            visits += cfg.iterations;
+            reused += result.reused;
+            seconds += result.seconds;
+            bytes += (double)result.bytes;
+            treeNodes += (double)result.treeNodes;
+            ++searches;
+            game.Move(result.move);
+            tree.Advance(result.move, game.board, game.next, game.GetDeckState());
+        }
+        score += game.board.Score();
+    }
+
+    printf("mcts: %u searches of %d iterations, %.3f s, %.0f iterations/s, %.0f nodes/s\n", searches, a_iterations, seconds, visits / seconds, nodes / seconds);
+    printf("mcts: %.1f bytes/node, %.0f nodes/tree, %.1f%% of the root visits reused\n", bytes / treeNodes, treeNodes / searches, 100.0 * reused / (reused + visits));
+    printf("(score after 100 moves %llu)\n", (unsigned long long)score);
+
+    // a whole game on a small budget: the arena fills up with nodes the game moved away from, a search has to start
+    // over before that, or the tree stops growing and it falls back to bare playouts
+    MCTS::Config smallCfg;
+    smallCfg.iterations = 500;
+    smallCfg.maxBytes   = 256 << 10;
+    MCTS smallTree(smallCfg);
+    Threes game(7);
+    smallTree.Reset(7);
+    uint32_t smallSearches = 0;
+    uint32_t starved       = 0;
+    while (!game.IsGameOver())
+    {
+        const MCTS::Result result = smallTree.Search(game.board, game.next, game.GetDeckState());
+        starved += result.nodes == 0 ? 1 : 0;
+        ++smallSearches;
+        game.Move(result.move);
+        smallTree.Advance(result.move, game.board, game.next, game.GetDeckState());
+    }
+    printf("mcts: %u KiB budget, %u searches, %u created no nodes\n", (unsigned)(smallCfg.maxBytes >> 10), smallSearches, starved);
+    if (starved > 0)
+    {
+        printf("mcts: the tree stopped growing on a full arena\n");
+        return 1;
+    }
+    return 0;
+}
+
+// the move a network picks on its own: the best reward plus afterstate value, what it was trained to predict
+EDirections PickNetworkMove(const NTupleNetwork& a_network, const PackedBoard& a_board)
+{
+    float best           = 0.0f;
+    EDirections bestMove = EDirections::COUNT;
+    for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+    {
+        PackedBoard afterstate = a_board;
+        if (!afterstate.Move((EDirections)dir))
+        {
+            continue;
+        }
+        const float value = NTupleNetwork::Reward(a_board, afterstate) + a_network.Evaluate(afterstate);
+        if (bestMove == EDirections::COUNT || value > best)
+        {
+            best     = value;
+            bestMove = (EDirections)dir;
+        }
+    }
+    return bestMove;
+}
+
+// a one move search on a network by hand: the move's reward plus the mean value of the boards its spawns leave
+float CalculateNetworkMoveValue(const NTupleNetwork& a_network, const PackedBoard& a_board, uint8_t a_next, EDirections a_dir)
+{
+    PackedBoard afterstate = a_board;
+    uint16_t moved;
+    if (!afterstate.Move(a_dir, &moved))
+    {
+        return -FLT_MAX;
+    }
+    const uint8_t lines = PackedBoard::MovedLines(a_dir, moved);
+    float sum           = 0.0f;
+    int n               = 0;
+    for (uint8_t line = 0; line < PackedBoard::EXTENT; ++line)
+    {
+        if ((lines & (1 << line)) == 0)
+            continue;
+        PackedBoard spawned = afterstate;
+        spawned.Set(PackedBoard::SpawnIndex(a_dir, line), a_next);
+        sum += a_network.EvaluateState(spawned);
+        ++n;
+    }
+    return NTupleNetwork::Reward(a_board, afterstate) + sum / n;
+}
+
+// network leaves only count the reward still to come, the search has to add the rewards of the moves on the way.
+// checks depth 1 move values against a search by hand, and that expectimax plays at least as well as the network
+int BenchNetwork(const char* a_weights, int a_games)
+{
+    NTupleNetwork network;
+    if (!a_weights || !network.Load(a_weights))
+    {
+        printf("network: needs n-tuple weights, see tthrees_train\n");
+        return a_weights ? 1 : 0;
+    }
+
+    Expectimax::Config oneMove;
+    oneMove.depth   = 1;
+    oneMove.network = &network;
+    Expectimax checker(oneMove);
+    uint32_t checked    = 0;
+    uint32_t mismatches = 0;
+    for (int seed = 0; seed < a_games; ++seed)
+    {
+        Threes game((uint32_t)seed);
+        while (!game.IsGameOver())
+        {
+            float values[(int)EDirections::COUNT];
+            checker.EvaluateMoves(game.board, game.next, game.GetDeckState(), values);
+            for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+            {
+                const float expected = CalculateNetworkMoveValue(network, game.board, game.next, (EDirections)dir);
+                mismatches += fabsf(values[dir] - expected) > 1e-3f * (1.0f + fabsf(expected)) ? 1 : 0;
+                ++checked;
+            }
+            game.Move(PickNetworkMove(network, game.board));
+        }
+    }
+    printf("network: %u depth 1 move values checked, %u mismatches\n", checked, mismatches);
+    if (mismatches > 0)
+    {
+        return 1;
+    }
+    const char* names[3] = { "network alone", "expectimax depth 1", "expectimax depth 2" };
+    double scores[3]     = {};
+    for (int policy = 0; policy < 3; ++policy)
+    {
+        Expectimax::Config cfg;
+        cfg.depth   = (uint8_t)policy;
+        cfg.network = &network;
+        Expectimax solver(cfg);
+        const auto start = std::chrono::steady_clock::now();
+        for (int seed = 0; seed < a_games; ++seed)
+        {
+            Threes game((uint32_t)seed);
+            while (!game.IsGameOver())
+            {
+                game.Move(policy == 0 ? PickNetworkMove(network, game.board) : solver.Search(game.board, game.next, game.GetDeckState()).move);
+            }
+            scores[policy] += game.board.Score();
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("network: %-18s mean score %8.1f over %d games, %.2f s\n", names[policy], scores[policy] / a_games, a_games, seconds);
+    }
+    if (scores[1] < scores[0] || scores[2] < scores[0])
+    {
+        printf("network: expectimax plays worse than the network alone\n");
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+// usage: tthrees_bench [moves|batch|games|replay|archive [games] [threads]|solver [depth] [tt MiB] [threads]|
+//                      deadline [ms] [max depth] [threads]|pruning [depth]|rollouts [playouts] [threads]|mcts [iterations]|
+//                      screen [width] [height]|pacing [frames] [fps]|network [weights] [games]]
+int main(int argc, char** argv)
+{
+    const char* section = argc > 1 ? argv[1] : nullptr;
+    int res             = 0;
+    if (res == 0 && (!section || strcmp(section, "moves") == 0))
+        res = BenchMoves();
+    if (res == 0 && (!section || strcmp(section, "batch") == 0))
+        res = BenchBatch();
+    if (res == 0 && (!section || strcmp(section, "games") == 0))
+        res = BenchGames();
+    if (res == 0 && (!section || strcmp(section, "replay") == 0))
+        res = BenchReplay();
+    if (res == 0 && (!section || strcmp(section, "archive") == 0))
+        res = BenchArchive(argc > 2 ? (uint32_t)atoi(argv[2]) : 200000, argc > 3 ? atoi(argv[3]) : (int)std::thread::hardware_concurrency());
+    if (res == 0 && (!section || strcmp(section, "solver") == 0))
+        res = BenchSolver(argc > 2 ? atoi(argv[2]) : 3, argc > 3 ? atoi(argv[3]) : 16, argc > 4 ? atoi(argv[4]) : 1);
+    if (res == 0 && (!section || strcmp(section, "deadline") == 0))
+        res = BenchDeadline(argc > 2 ? atoi(argv[2]) : 10, argc > 3 ? atoi(argv[3]) : 8, argc > 4 ? atoi(argv[4]) : 1);
+    if (res == 0 && (!section || strcmp(section, "pruning") == 0))
+        res = BenchPruning(argc > 2 ? atoi(argv[2]) : 4);
+    if (res == 0 && (!section || strcmp(section, "rollouts") == 0))
+        res = BenchRollouts(argc > 2 ? atoi(argv[2]) : 256, argc > 3 ? atoi(argv[3]) : 1);
+    if (res == 0 && (!section || strcmp(section, "mcts") == 0))
+        res = BenchTree(argc > 2 ? atoi(argv[2]) : 2000);
+    if (res == 0 && (!section || strcmp(section, "screen") == 0))
+        res = BenchScreen(argc > 2 ? atoi(argv[2]) : 240, argc > 3 ? atoi(argv[3]) : 70);
+    if (res == 0 && (!section || strcmp(section, "pacing") == 0))
+        res = BenchPacing(argc > 2 ? atoi(argv[2]) : 120, argc > 3 ? atoi(argv[3]) : 60);
+    if (res == 0 && (!section || strcmp(section, "network") == 0))
+        res = BenchNetwork(argc > 2 ? argv[2] : nullptr, argc > 3 ? atoi(argv[3]) : 50);
+    return res;
+}
@@ -0,0 +1,376 @@
+#include <ai/expectimax.h>
+#include <ai/heuristic.h>
+#include <ai/mcts.h>
+#include <ai/montecarlo.h>
+#include <ai/ntuple.h>
+#include <core/archive.h>
+#include <core/replay.h>
+#include <core/threes.h>
+#include <util/threadpool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+namespace
+{
+enum class EPolicies : uint8_t
+{
+    Random = 0,
+    Greedy,
+    Expectimax,
+    MonteCarlo,
+    MCTS,
+
+    COUNT,
+};
+const char* g_policyNames[(int)EPolicies::COUNT] = { "random", "greedy", "expectimax", "montecarlo", "mcts" };
+// the random policy draws from its own stream, so its moves never shift the rules' draws
+const uint64_t g_policyStream = 1;
+
+struct Options
+{
+    EPolicies policy     = EPolicies::Greedy;
+    uint32_t firstSeed   = 0;
+    uint32_t games       = 10000;
+    int threads          = 0; // 0: one per core
+    uint8_t depth        = 2;  // expectimax only
+    uint32_t timeLimit   = 0;  // expectimax only, ms per move with depth as the limit; results then vary by machine
+    uint32_t playouts    = 64;   // montecarlo only, per move
+    uint32_t iterations  = 1000; // mcts only
+    size_t ttBytes       = 4 << 20;
+    const char* csvPath  = nullptr;
+    const char* archive  = nullptr; // replays of all games are appended to it
+    const char* weights  = nullptr; // n-tuple network instead of the heuristic
+    const char* progName = "tthrees_tournament";
+};
+
+struct GameResult
+{
+    uint32_t seed;
+    uint32_t score;
+    uint32_t moves;
+    uint8_t maxTile;
+    bool won;
+};
+
+// everything a worker thread needs for its games, created once and reused for every game it picks up
+struct Worker
+{
+    std::unique_ptr<Expectimax> solver;
+    std::unique_ptr<MCTS> tree;
+};
+
+uint32_t DisplayValue(uint8_t a_value)
+{
+    return a_value < 3 ? a_value : 3U << (a_value - 3);
+}
+
+// the single move lookahead: the afterstate with the best evaluation, ignoring the spawn
+EDirections PickGreedyMove(const PackedBoard& a_board, const NTupleNetwork* a_network)
+{
+    float best           = 0.0f;
+    EDirections bestMove = EDirections::COUNT;
+    for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+    {
+        PackedBoard afterstate = a_board;
+        if (!afterstate.Move((EDirections)dir))
+        {
+            continue;
+        }
+        const float value = a_network ? NTupleNetwork::Reward(a_board, afterstate) + a_network->Evaluate(afterstate) : Heuristic::Evaluate(afterstate);
+        if (bestMove == EDirections::COUNT || value > best)
+        {
+            best     = value;
+            bestMove = (EDirections)dir;
+        }
+    }
+    return bestMove;
+}
+
+// the outcome only depends on the seed and the policy, never on the thread that happened to play it
+GameResult PlayGame(const Options& a_opts, const NTupleNetwork* a_network, Worker& a_worker, uint32_t a_seed, Replay* out_replay)
+{
+    Threes game(a_seed);
+    if (out_replay)
+        out_replay->Reset(a_seed);
+    Random policyRandom(a_seed, g_policyStream);
+    // a chooser per game ties its playout streams to the seed
+    MonteCarlo::Config mcCfg;
+    mcCfg.playouts = a_opts.playouts;
+    mcCfg.batch    = a_opts.playouts < 16 ? a_opts.playouts : 16;
+    mcCfg.seed     = a_seed;
+    MonteCarlo monteCarlo(mcCfg);
+    if (a_worker.tree)
+        a_worker.tree->Reset(a_seed);
+    GameResult result = {};
+    result.seed       = a_seed;
+    while (!game.IsGameOver() && !game.IsGameWon())
+    {
+        EDirections move = EDirections::COUNT;
+        switch (a_opts.policy)
+        {
+            case EPolicies::Random: move = (EDirections)(policyRandom.Next() % (uint32_t)EDirections::COUNT); break;
+            case EPolicies::Greedy: move = PickGreedyMove(game.board, a_network); break;
+            case EPolicies::Expectimax: move = a_worker.solver->Search(game.board, game.next, game.GetDeckState()).move; break;
+            case EPolicies::MonteCarlo: move = monteCarlo.Search(game).move; break;
+            case EPolicies::MCTS: move = a_worker.tree->Search(game.board, game.next, game.GetDeckState()).move; break;
+            default: break;
+        }
+        if (move != EDirections::COUNT && game.Move(move))
+        {
+            ++result.moves;
+            if (out_replay)
+                out_replay->Push(move);
+            if (a_worker.tree)
+                a_worker.tree->Advance(move, game.board, game.next, game.GetDeckState());
+        }
+    }
+    result.score   = game.board.Score();
+    result.maxTile = game.board.MaxTile();
+    result.won     = game.IsGameWon();
+    return result;
+}
+
+uint32_t Percentile(const std::vector<uint32_t>& a_sorted, double a_fraction)
+{
+    return a_sorted[(size_t)(a_fraction * (a_sorted.size() - 1))];
+}
+
+void PrintHistogramRow(const char* a_label, uint64_t a_count, uint64_t a_total)
+{
+    const int width = (int)(50 * a_count / a_total);
+    printf("  %10s %9llu %6.2f%% ", a_label, (unsigned long long)a_count, 100.0 * a_count / a_total);
+    for (int i = 0; i < width; ++i)
+    {
+        putchar('#');
+    }
+    putchar('\n');
+}
+
+void PrintSummary(const Options& a_opts, const std::vector<GameResult>& a_results, int a_threads, double a_seconds)
+{
+    const uint64_t total = a_results.size();
+    std::vector<uint32_t> scores;
+    std::vector<uint32_t> lengths;
+    uint64_t tiles[PackedBoard::MAX_VALUE + 1] = {};
+    uint64_t scoreBuckets[32]                  = {};
+    uint64_t lengthBuckets[32]                 = {};
+    uint64_t moves                             = 0;
+    uint64_t won                               = 0;
+    double scoreSum                            = 0.0;
+    for (const GameResult& r : a_results)
+    {
+        scores.push_back(r.score);
+        lengths.push_back(r.moves);
+        ++tiles[r.maxTile];
+        int log2 = 0;
+        while ((r.score >> log2) > 1)
+            ++log2;
+        ++scoreBuckets[log2];
+        ++lengthBuckets[r.moves / 100 < 31 ? r.moves / 100 : 31];
+        moves += r.moves;
+        won += r.won ? 1 : 0;
+        scoreSum += r.score;
+    }
+    std::sort(scores.begin(), scores.end());
+    std::sort(lengths.begin(), lengths.end());
+
+    printf("policy %s", g_policyNames[(int)a_opts.policy]);
+    if (a_opts.policy == EPolicies::Expectimax && a_opts.timeLimit > 0)
+        printf(" (depth <= %d, %u ms per move)", a_opts.depth, a_opts.timeLimit);
+    else if (a_opts.policy == EPolicies::Expectimax)
+        printf(" (depth %d)", a_opts.depth);
+    if (a_opts.policy == EPolicies::MonteCarlo)
+        printf(" (%u playouts per move)", a_opts.playouts);
+    if (a_opts.policy == EPolicies::MCTS)
+        printf(" (%u iterations)", a_opts.iterations);
+    if (a_opts.weights)
+        printf(" on %s", a_opts.weights);
+    printf(", seeds %u..%u, %d threads\n", a_opts.firstSeed, a_opts.firstSeed + a_opts.games - 1, a_threads);
+    printf("%llu games in %.2f s: %.0f games/s, %.0f moves/s\n", (unsigned long long)total, a_seconds, total / a_seconds, moves / a_seconds);
+    printf("score:  mean %.1f, min %u, p50 %u, p90 %u, p99 %u, max %u\n", scoreSum / total, scores.front(), Percentile(scores, 0.5), Percentile(scores, 0.9), Percentile(scores, 0.99), scores.back());
+    printf("length: mean %.1f, min %u, p50 %u, p90 %u, p99 %u, max %u\n", (double)moves / total, lengths.front(), Percentile(lengths, 0.5), Percentile(lengths, 0.9), Percentile(lengths, 0.99), lengths.back());
+    printf("won:    %llu (%.2f%%)\n", (unsigned long long)won, 100.0 * won / total);
+
+    char label[32];
+    printf("max tile:\n");
+    for (uint8_t value = 0; value <= PackedBoard::MAX_VALUE; ++value)
+    {
+        if (tiles[value] == 0)
+            continue;
+        snprintf(label, sizeof(label), "%u", DisplayValue(value));
+        PrintHistogramRow(label, tiles[value], total);
+    }
+    printf("score:\n");
+    for (int log2 = 0; log2 < 32; ++log2)
+    {
+        if (scoreBuckets[log2] == 0)
+            continue;
+        snprintf(label, sizeof(label), "< %u", 2U << log2);
+        PrintHistogramRow(label, scoreBuckets[log2], total);
+    }
+    printf("length:\n");
+    for (int bucket = 0; bucket < 32; ++bucket)
+    {
+        if (lengthBuckets[bucket] == 0)
+            continue;
+        if (bucket < 31)
+            snprintf(label, sizeof(label), "< %d", 100 * (bucket + 1));
+        else
+            snprintf(label, sizeof(label), ">= %d", 100 * bucket);
+        PrintHistogramRow(label, lengthBuckets[bucket], total);
+    }
+}
+
+bool WriteCSV(const char* a_path, const std::vector<GameResult>& a_results)
+{
+    FILE* file = strcmp(a_path, "-") == 0 ? stdout : fopen(a_path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "cannot open %s\n", a_path);
+        return false;
+    }
+    fprintf(file, "seed,score,max_tile,moves,won\n");
+    for (const GameResult& r : a_results)
+    {
+        fprintf(file, "%u,%u,%u,%u,%d\n", r.seed, r.score, DisplayValue(r.maxTile), r.moves, r.won ? 1 : 0);
+    }
+    if (file != stdout)
+        fclose(file);
+    return true;
+}
+
+int PrintUsage(const char* a_progName)
+{
+    fprintf(stderr,
+            "usage: %s [-p random|greedy|expectimax|montecarlo|mcts] [-s first seed] [-n games] [-t threads] [-d depth] [-l ms per move] [-m tt MiB] [-k playouts] [-i iterations] [-w n-tuple weights] [-o results.csv|-] [-r replays.ttra]\n",
+            a_progName);
+    return 1;
+}
+
+bool ParseOptions(int argc, char** argv, Options& out_opts)
+{
+    out_opts.progName = argv[0];
+    for (int i = 1; i < argc; ++i)
+    {
+        if (argv[i][0] != '-' || argv[i][1] == 0 || argv[i][2] != 0 || i + 1 >= argc)
+        {
+            return false;
+        }
+        const char* value = argv[++i];
+        switch (argv[i - 1][1])
+        {
+            case 'p':
+            {
+                int policy = 0;
+                while (policy < (int)EPolicies::COUNT && strcmp(value, g_policyNames[policy]) != 0)
+                    ++policy;
+                if (policy == (int)EPolicies::COUNT)
+                    return false;
+                out_opts.policy = (EPolicies)policy;
+                break;
+            }
+            case 's': out_opts.firstSeed = (uint32_t)strtoul(value, nullptr, 10); break;
+            case 'n': out_opts.games = (uint32_t)strtoul(value, nullptr, 10); break;
+            case 't': out_opts.threads = atoi(value); break;
+            case 'd': out_opts.depth = (uint8_t)atoi(value); break;
+            case 'l': out_opts.timeLimit = (uint32_t)strtoul(value, nullptr, 10); break;
+            case 'm': out_opts.ttBytes = (size_t)atoi(value) << 20; break;
+            case 'o': out_opts.csvPath = value; break;
+            case 'r': out_opts.archive = value; break;
+            case 'w': out_opts.weights = value; break;
+            case 'i': out_opts.iterations = (uint32_t)strtoul(value, nullptr, 10); break;
+            case 'k': out_opts.playouts = (uint32_t)strtoul(value, nullptr, 10); break;
+            default: return false;
+        }
+    }
+    return out_opts.games > 0 && out_opts.playouts > 0;
+}
+
+} // namespace
+
+// plays a range of seeds with one policy on every core and reports score, max tile and game length distributions
+int main(int argc, char** argv)
+{
+    Options opts;
+    if (!ParseOptions(argc, argv, opts))
+    {
+        return PrintUsage(opts.progName);
+    }
+    int threads = opts.threads > 0 ? opts.threads : (int)std::thread::hardware_concurrency();
+    if (threads < 1)
+        threads = 1;
+
+    NTupleNetwork network;
+    if (opts.weights && !network.Load(opts.weights))
+    {
+        fprintf(stderr, "cannot load %s\n", opts.weights);
+        return 1;
+    }
+    const NTupleNetwork* evaluator = opts.weights ? &network : nullptr;
+
+    std::vector<Worker> workers(threads);
+    if (opts.policy == EPolicies::Expectimax)
+    {
+        Expectimax::Config cfg;
+        cfg.depth     = opts.depth;
+        cfg.timeLimit = opts.timeLimit;
+        cfg.ttBytes   = opts.ttBytes;
+        cfg.network   = evaluator;
+        for (Worker& worker : workers)
+        {
+            worker.solver.reset(new Expectimax(cfg));
+        }
+    }
+    if (opts.policy == EPolicies::MCTS)
+    {
+        MCTS::Config cfg;
+        cfg.iterations = opts.iterations;
+        for (Worker& worker : workers)
+        {
+            worker.tree.reset(new MCTS(cfg));
+        }
+    }
+
+    std::vector<GameResult> results(opts.games);
+    std::vector<Replay> replays(opts.archive ? opts.games : 0);
+    ThreadPool pool(threads);
+    const auto start = std::chrono::steady_clock::now();
+    pool.ParallelFor(opts.games, [&](size_t a_index, int a_thread) {
+        Replay* replay   = opts.archive ? &replays[a_index] : nullptr;
+        results[a_index] = PlayGame(opts, evaluator, workers[a_thread], opts.firstSeed + (uint32_t)a_index, replay);
+    });
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (opts.archive)
+    {
+        // in seed order, whichever thread finished first
+        ReplayArchiveWriter writer;
+        bool ok = writer.Open(opts.archive);
+        for (size_t i = 0; ok && i < replays.size(); ++i)
+        {
+            ok = writer.Append(replays[i]);
+        }
+        if (!writer.Close() || !ok)
+        {
+            fprintf(stderr, "cannot write %s\n", opts.archive);
+            return 1;
+        }
+    }
+
+    if (opts.csvPath && !WriteCSV(opts.csvPath, results))
+    {
+        return 1;
+    }
+    if (!opts.csvPath || strcmp(opts.csvPath, "-") != 0)
+    {
+        PrintSummary(opts, results, threads, seconds);
+    }
+    return 0;
+}
@@ -0,0 +1,215 @@
+#include <ai/ntuple.h>
+#include <core/threes.h>
+#include <util/threadpool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct Options
+{
+    uint64_t games       = 100000;
+    uint32_t epochGames  = 10000; // games between reports and checkpoints
+    int threads          = 0;     // 0: one per core
+    float alpha          = 0.0025f;
+    uint64_t seed        = 1;
+    const char* input    = nullptr;
+    const char* output   = "ntuple.bin";
+    const char* progName = "tthrees_train";
+};
+
+struct EpochStats
+{
+    std::atomic<uint64_t> score;
+    std::atomic<uint64_t> moves;
+    std::atomic<uint32_t> maxScore;
+    std::atomic<uint32_t> tiles[PackedBoard::MAX_VALUE + 1];
+
+    EpochStats()
+    {
+        Reset();
+    }
+    void Reset()
+    {
+        score    = 0;
+        moves    = 0;
+        maxScore = 0;
+        for (std::atomic<uint32_t>& tile : tiles)
+        {
+            tile = 0;
+        }
+    }
+};
+
+// one self play game, learning after every move: the previous afterstate is pulled towards the reward and the
+// value of the afterstate that followed it (TD(0) on afterstates). a_learner belongs to the calling thread.
+void TrainGame(NTupleNetwork::Learner& a_learner, float a_alpha, Threes& a_game, EpochStats& a_stats)
+{
+    PackedBoard previous;
+    bool hasPrevious = false;
+    uint64_t moves   = 0;
+    while (!a_game.IsGameOver())
+    {
+        float best           = 0.0f;
+        EDirections bestMove = EDirections::COUNT;
+        PackedBoard bestAfterstate;
+        for (uint8_t dir = 0; dir < (uint8_t)EDirections::COUNT; ++dir)
+        {
+            PackedBoard afterstate = a_game.board;
+            if (!afterstate.Move((EDirections)dir))
+            {
+                continue;
+            }
+            const float value = NTupleNetwork::Reward(a_game.board, afterstate) + a_learner.Evaluate(afterstate);
+            if (bestMove == EDirections::COUNT || value > best)
+            {
+                best           = value;
+                bestMove       = (EDirections)dir;
+                bestAfterstate = afterstate;
+            }
+        }
+        if (hasPrevious)
+        {
+            a_learner.Update(previous, a_alpha * (best - a_learner.Evaluate(previous)));
+        }
+        a_game.Move(bestMove);
+        previous    = bestAfterstate;
+        hasPrevious = true;
+        ++moves;
+    }
+    if (hasPrevious)
+    {
+        a_learner.Update(previous, -a_alpha * a_learner.Evaluate(previous));
+    }
+
+    const uint32_t score = a_game.board.Score();
+    a_stats.score += score;
+    a_stats.moves += moves;
+    ++a_stats.tiles[a_game.board.MaxTile()];
+    uint32_t highest = a_stats.maxScore;
+    while (score > highest && !a_stats.maxScore.compare_exchange_weak(highest, score))
+    {
+    }
+}
+
+void PrintEpoch(uint64_t a_games, uint32_t a_epochGames, const EpochStats& a_stats, double a_seconds)
+{
+    printf("%10llu games: mean score %8.1f, max %7u, %6.1f moves/game, %7.0f games/s, max tile",
+           (unsigned long long)a_games,
+           (double)a_stats.score / a_epochGames,
+           (uint32_t)a_stats.maxScore,
+           (double)a_stats.moves / a_epochGames,
+           a_epochGames / a_seconds);
+    // share of games reaching at least the given tile, for the three largest ones reached
+    uint32_t atLeast = 0;
+    int shown        = 0;
+    for (int value = PackedBoard::MAX_VALUE; value >= 3 && shown < 3; --value)
+    {
+        atLeast += a_stats.tiles[value];
+        if (a_stats.tiles[value] > 0)
+        {
+            printf(" %u: %.1f%%", 3U << (value - 3), 100.0 * atLeast / a_epochGames);
+            ++shown;
+        }
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+int PrintUsage(const char* a_progName)
+{
+    fprintf(stderr,
+            "usage: %s [-g games] [-e games per epoch] [-t threads] [-a learning rate] [-s seed] [-i initial weights] [-o weights]\n",
+            a_progName);
+    return 1;
+}
+
+bool ParseOptions(int argc, char** argv, Options& out_opts)
+{
+    out_opts.progName = argv[0];
+    for (int i = 1; i < argc; ++i)
+    {
+        if (argv[i][0] != '-' || argv[i][1] == 0 || argv[i][2] != 0 || i + 1 >= argc)
+        {
+            return false;
+        }
+        const char* value = argv[++i];
+        switch (argv[i - 1][1])
+        {
+            case 'g': out_opts.games = strtoull(value, nullptr, 10); break;
+            case 'e': out_opts.epochGames = (uint32_t)strtoul(value, nullptr, 10); break;
+            case 't': out_opts.threads = atoi(value); break;
+            case 'a': out_opts.alpha = (float)atof(value); break;
+            case 's': out_opts.seed = strtoull(value, nullptr, 10); break;
+            case 'i': out_opts.input = value; break;
+            case 'o': out_opts.output = value; break;
+            default: return false;
+        }
+    }
+    return out_opts.games > 0 && out_opts.epochGames > 0 && out_opts.alpha > 0.0f;
+}
+
+} // namespace
+
+// learns NTupleNetwork weights by self play, saving them after every epoch
+int main(int argc, char** argv)
+{
+    Options opts;
+    if (!ParseOptions(argc, argv, opts))
+    {
+        return PrintUsage(opts.progName);
+    }
+    int threads = opts.threads > 0 ? opts.threads : (int)std::thread::hardware_concurrency();
+    if (threads < 1)
+        threads = 1;
+
+    NTupleNetwork network;
+    if (opts.input && !network.Load(opts.input))
+    {
+        fprintf(stderr, "cannot load %s\n", opts.input);
+        return 1;
+    }
+
+    // the threads play a game each against the same weights, seeing only their own updates. after every round the
+    // updates are added to the network: learning is a round of games behind on other threads, but nothing is
+    // written while another thread reads it
+    ThreadPool pool(threads);
+    std::vector<NTupleNetwork::Learner> learners(threads, NTupleNetwork::Learner(network));
+    EpochStats stats;
+    int res = 0;
+    for (uint64_t played = 0; played < opts.games && res == 0;)
+    {
+        const uint32_t epochGames = (uint32_t)(opts.games - played < opts.epochGames ? opts.games - played : opts.epochGames);
+        const auto start          = std::chrono::steady_clock::now();
+        stats.Reset();
+        for (uint32_t round = 0; round < epochGames; round += threads)
+        {
+            const uint64_t first = played + round;
+            pool.ParallelFor(std::min(epochGames - round, (uint32_t)threads), [&](size_t a_index, int a_thread) {
+                // one stream per game: the spawns of game n are the same whatever thread plays it
+                Threes game(Random(opts.seed, first + a_index));
+                TrainGame(learners[a_thread], opts.alpha, game, stats);
+            });
+            for (NTupleNetwork::Learner& learner : learners)
+            {
+                learner.Apply(network);
+            }
+        }
+        played += epochGames;
+        PrintEpoch(played, epochGames, stats, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+        if (!network.Save(opts.output))
+        {
+            fprintf(stderr, "cannot save %s\n", opts.output);
+            res = 1;
+        }
+    }
+    return res;
+}
@@ -182,6 +182,14 @@ struct TUI
 
         operator uint8_t() const { return raw; }
     };
+    struct FrameStats
+    {
+        uint32_t frames = 0; // in the window the times are taken from
+        float minMs     = 0.0f;
+        float p50Ms     = 0.0f;
+        float p99Ms     = 0.0f;
+        float maxMs     = 0.0f;
+    };
     static Color s_color;
     struct ColorScope
     {
@@ -205,8 +213,14 @@ struct TUI
     static void Shutdown();
     static void BeginFrame(bool& out_sizeChanged);
     static void EndFrame(int a_targetFps = 60);
+    // blocks until a key arrives, the terminal is resized or Wake is called. for idle frames, after EndFrame(0)
+    static void WaitForEvents();
+    // ends a WaitForEvents (or the next one), from any thread
+    static void Wake();
     static void ClearScreen();
     static float GetDeltaSeconds(float a_max = 0.03f);
+    // times of the last paced frames (EndFrame with a target fps), from the end of one to the end of the next
+    static FrameStats GetFrameStats();
     static bool IsKeyPressed(EKeys a_key, EModifiers a_modifiers = EModifiers::Modifier_None);
     static void GetSize(int& out_w, int& out_h);
     static void DrawLine(int a_fromX, int a_fromY, int a_toX, int a_toY, char a_char = ' ');
@@ -249,11 +263,16 @@ struct TUI
 };
 
 #ifdef TUI_IMPLEMENTATION
+#include <algorithm>
 #include <chrono>
 #include <stdio.h>
 #include <string.h>
 #include <thread>
 #include <vector>
+#if !defined(_WIN32)
+#include <errno.h>
+#include <time.h>
+#endif
 
 TUI::Color TUI::s_color(TUI::EColors::White, TUI::EColors::Black);
 
@@ -330,36 +349,98 @@ private:
     uint8_t m_bytes[kByteCount];
 };
 
+// paces frames against absolute deadlines: oversleeping one frame does not push back the ones after it.
+// keeps the times of the last FRAME_WINDOW paced frames for TUI::GetFrameStats
 static struct FrameTimer
 {
-    std::chrono::high_resolution_clock::time_point frameStart = std::chrono::high_resolution_clock::now();
+    typedef std::chrono::steady_clock Clock;
+    static constexpr int FRAME_WINDOW = 1024;
+#if defined(_WIN32)
+    static constexpr int SPIN_MICROSECONDS = 2000;
+#else
+    static constexpr int SPIN_MICROSECONDS = 200;
+#endif
+
+    Clock::time_point frameStart = Clock::now();
+    Clock::time_point frameEnd;
+    Clock::time_point deadline;
+    bool paced = false; // the last frame ended on a deadline
     std::chrono::duration<float> deltaSeconds;
+    uint32_t frameTimes[FRAME_WINDOW]; // microseconds, a ring
+    uint32_t frameCount = 0;
 
     void BeginFrame()
     {
-        frameStart = std::chrono::high_resolution_clock::now();
+        frameStart = Clock::now();
     }
     void EndFrame(int a_targetFps = 60)
     {
         if (a_targetFps > 0)
         {
-            const double targetMs                                   = 1000.0 / static_cast<double>(a_targetFps);
-            auto frameEnd                                           = std::chrono::high_resolution_clock::now();
-            std::chrono::duration<double, std::milli> frameDuration = frameEnd - frameStart;
-            if (frameDuration.count() < targetMs)
-            {
-                std::chrono::duration<double, std::milli> deltaMs(targetMs - frameDuration.count());
-                auto sleepDuration = std::chrono::duration_cast<std::chrono::milliseconds>(deltaMs);
-                std::this_thread::sleep_for(std::chrono::milliseconds(sleepDuration.count()));
-            }
+            const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / a_targetFps));
+            // deadlines follow each other while the frames keep up. the first paced frame starts a new chain and so
+            // does a frame that missed its deadline, instead of rushing the next ones to catch up
+            deadline                    = (paced ? deadline : frameStart) + period;
+            const Clock::time_point now = Clock::now();
+            if (deadline > now)
+                SleepUntil(deadline);
+            else
+                deadline = now;
         }
-        deltaSeconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - frameStart);
+        const Clock::time_point now = Clock::now();
+        deltaSeconds                = now - (paced ? frameEnd : frameStart);
+        if (a_targetFps > 0)
+        {
+            const float micro                     = deltaSeconds.count() * 1e6f;
+            frameTimes[frameCount % FRAME_WINDOW] = micro < 4e9f ? (uint32_t)micro : UINT32_MAX;
+            ++frameCount;
+        }
+        paced    = a_targetFps > 0;
+        frameEnd = now;
     }
     float GetDeltaSeconds(float a_max = 0.03f) const
     {
         std::chrono::duration<float> max(a_max);
         return (deltaSeconds > max ? max : deltaSeconds).count();
     }
+    TUI::FrameStats GetStats() const
+    {
+        TUI::FrameStats stats;
+        const uint32_t n = std::min(frameCount, (uint32_t)FRAME_WINDOW);
+        if (n == 0)
+            return stats;
+        uint32_t sorted[FRAME_WINDOW];
+        std::copy(frameTimes, frameTimes + n, sorted);
+        std::sort(sorted, sorted + n);
+        stats.frames = n;
+        stats.minMs  = sorted[0] / 1000.0f;
+        stats.p50Ms  = sorted[(n - 1) * 50 / 100] / 1000.0f;
+        stats.p99Ms  = sorted[(n - 1) * 99 / 100] / 1000.0f;
+        stats.maxMs  = sorted[n - 1] / 1000.0f;
+        return stats;
+    }
+
+private:
+    // sleeps to shortly before a_deadline and spins the rest: the scheduler may wake a sleeper late, but rarely by
+    // more than SPIN_MICROSECONDS
+    static void SleepUntil(Clock::time_point a_deadline)
+    {
+        const Clock::time_point wake = a_deadline - std::chrono::microseconds((int)SPIN_MICROSECONDS);
+#if defined(_WIN32)
+        std::this_thread::sleep_until(wake);
+#else
+        // steady_clock is CLOCK_MONOTONIC
+        const long long ns = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(wake.time_since_epoch()).count();
+        struct timespec time;
+        time.tv_sec  = (time_t)(ns / 1000000000);
+        time.tv_nsec = (long)(ns % 1000000000);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, nullptr) == EINTR)
+        {
+        }
+#endif
+        while (Clock::now() < a_deadline)
+            std::this_thread::yield();
+    }
 } g_frameTimer;
 
 struct Input
@@ -389,30 +470,141 @@ union Cell
 
     operator int() const { return raw; }
 };
+// a run of cells [begin, end) in one row, empty if begin >= end
+struct Span
+{
+    uint16_t begin = 0;
+    uint16_t end   = 0;
+
+    bool IsEmpty() const { return begin >= end; }
+    void Add(uint16_t a_begin, uint16_t a_end)
+    {
+        if (a_begin >= a_end)
+            return;
+        if (IsEmpty())
+        {
+            begin = a_begin;
+            end   = a_end;
+            return;
+        }
+        begin = std::min(begin, a_begin);
+        end   = std::max(end, a_end);
+    }
+};
+// every write marks its cells in two spans per row: `dirty` (may differ from the last presented frame, reset by
+// the backend's EndFrame) and `drawn` (may differ from the erase char, reset by Clear). Clear only erases the drawn
+// spans, so redrawing a frame makes the area that was drawn dirty instead of the whole screen.
 struct Buffer
 {
     static char s_eraseChar;
     uint16_t width  = 0;
     uint16_t height = 0;
     std::vector<Cell> data;
+    std::vector<Span> dirty;
+    std::vector<Span> drawn;
 
     void Clear()
     {
         Cell c(TUI::Color(0), s_eraseChar);
-        std::fill(data.begin(), data.end(), c);
+        for (uint16_t y = 0; y < height; ++y)
+        {
+            Span& span = drawn[y];
+            if (span.IsEmpty())
+                continue;
+            std::fill(data.begin() + y * width + span.begin, data.begin() + y * width + span.end, c);
+            dirty[y].Add(span.begin, span.end);
+            span = Span();
+        }
     }
     void Resize(uint16_t a_width, uint16_t a_height)
     {
         width  = a_width;
         height = a_height;
-        data.resize(width * height);
-        Clear();
+        data.assign(width * height, Cell(TUI::Color(0), s_eraseChar));
+        dirty.assign(height, Span());
+        drawn.assign(height, Span());
+        for (Span& span : dirty)
+            span.Add(0, width);
+    }
+    // a_begin and a_end are clipped to the buffer
+    void MarkDrawn(int a_y, int a_begin, int a_end)
+    {
+        if (a_y < 0 || a_y >= height)
+            return;
+        const int begin = std::max(0, std::min(a_begin, (int)width));
+        const int end   = std::max(0, std::min(a_end, (int)width));
+        if (begin >= end)
+            return;
+        dirty[a_y].Add((uint16_t)begin, (uint16_t)end);
+        drawn[a_y].Add((uint16_t)begin, (uint16_t)end);
     }
+    void ResetDirty() { std::fill(dirty.begin(), dirty.end(), Span()); }
     Cell& operator()(uint16_t a_x, uint16_t a_y) { return data[a_y * width + a_x]; }
     const Cell& operator()(uint16_t a_x, uint16_t a_y) const { return data[a_y * width + a_x]; }
 } g_consoleData;
 char Buffer::s_eraseChar = ' ';
 
+
+// hands every cell of the dirty spans of a_data that differs from a_cache to a_changed(x, y, cell), updates
+// a_cache and resets the dirty spans. returns the number of cells compared
+template <typename F>
+uint32_t PresentDirty(Buffer& a_data, Buffer& a_cache, F a_changed)
+{
+    if (a_cache.width != a_data.width || a_cache.height != a_data.height)
+        a_cache.Resize(a_data.width, a_data.height);
+
+    uint32_t visited = 0;
+    for (uint16_t y = 0; y < a_data.height; ++y)
+    {
+        const Span& span = a_data.dirty[y];
+        for (uint16_t x = span.begin; x < span.end; ++x)
+        {
+            const Cell& dataCell = a_data(x, y);
+            Cell& cacheCell      = a_cache(x, y);
+            if (cacheCell.raw != dataCell.raw)
+            {
+                a_changed(x, y, dataCell);
+                cacheCell = dataCell;
+            }
+        }
+        if (!span.IsEmpty())
+            visited += span.end - span.begin;
+    }
+    a_data.ResetDirty();
+    return visited;
+}
+
+std::vector<char> g_runText;
+
+// PresentDirty with horizontally adjacent changed cells of one color joined into runs: a_run(x, y, color, text, length)
+// is called once per run, the text is not null terminated
+template <typename F>
+uint32_t PresentRuns(Buffer& a_data, Buffer& a_cache, F a_run)
+{
+    std::vector<char>& text = g_runText;
+    int runX                = 0;
+    int runY                = 0;
+    uint8_t runColor        = 0;
+    text.clear();
+    auto flush = [&]() {
+        if (!text.empty())
+            a_run(runX, runY, runColor, text.data(), (int)text.size());
+        text.clear();
+    };
+    const uint32_t visited = PresentDirty(a_data, a_cache, [&](int a_x, int a_y, const Cell& a_cell) {
+        if (text.empty() || a_y != runY || a_x != runX + (int)text.size() || a_cell.color != runColor)
+        {
+            flush();
+            runX     = a_x;
+            runY     = a_y;
+            runColor = a_cell.color;
+        }
+        text.push_back((char)a_cell.value);
+    });
+    flush();
+    return visited;
+}
+
 } // namespace TUI_Shared
 
 void TUI::ClearScreen()
@@ -425,6 +617,11 @@ float TUI::GetDeltaSeconds(float a_max)
     return TUI_Shared::g_frameTimer.GetDeltaSeconds(a_max);
 }
 
+TUI::FrameStats TUI::GetFrameStats()
+{
+    return TUI_Shared::g_frameTimer.GetStats();
+}
+
 bool TUI::IsKeyPressed(EKeys a_key, EModifiers a_modifiers)
 {
     const int key      = (int)a_key;
@@ -457,11 +654,15 @@ void TUI::DrawLine(int a_fromX, int a_fromY, int a_toX, int a_toY, char a_char)
     {
         for (int x = xStart; x <= xEnd; ++x)
             TUI_Shared::g_consoleData(x, a_fromY) = c;
+        TUI_Shared::g_consoleData.MarkDrawn(a_fromY, xStart, xEnd + 1);
     }
     else if (dx == 0 && a_fromX >= 0 && a_fromX < w) // vertical line
     {
         for (int y = yStart; y <= yEnd; ++y)
+        {
             TUI_Shared::g_consoleData(a_fromX, y) = c;
+            TUI_Shared::g_consoleData.MarkDrawn(y, a_fromX, a_fromX + 1);
+        }
     }
     else if (dx >= dy) // more horizontal than vertical
     {
@@ -472,7 +673,10 @@ void TUI::DrawLine(int a_fromX, int a_fromY, int a_toX, int a_toY, char a_char)
         for (int x = a_fromX; x != a_toX + incX; x += incX)
         {
             if (x > 0 && x < w && y > 0 && y < h)
+            {
                 TUI_Shared::g_consoleData(x, y) = c;
+                TUI_Shared::g_consoleData.MarkDrawn(y, x, x + 1);
+            }
             error += slope;
             if (error >= 0)
             {
@@ -490,7 +694,10 @@ void TUI::DrawLine(int a_fromX, int a_fromY, int a_toX, int a_toY, char a_char)
         for (int y = a_fromY; y != a_toY + incY; y += incY)
         {
             if (x > 0 && x < w && y > 0 && y < h)
+            {
                 TUI_Shared::g_consoleData(x, y) = c;
+                TUI_Shared::g_consoleData.MarkDrawn(y, x, x + 1);
+            }
             error += slope;
             if (error >= 0)
             {
@@ -512,8 +719,11 @@ void TUI::DrawRect(int a_x, int a_y, int a_w, int a_h, char a_char)
 
     const TUI_Shared::Cell c(s_color, a_char);
     for (int y = y0; y < y1; ++y)
+    {
         for (int x = x0; x < x1; ++x)
             TUI_Shared::g_consoleData(x, y) = c;
+        TUI_Shared::g_consoleData.MarkDrawn(y, x0, x1);
+    }
 }
 
 void TUI::DrawChar(int a_x, int a_y, char a_c)
@@ -524,6 +734,7 @@ void TUI::DrawChar(int a_x, int a_y, char a_c)
     {
         const TUI_Shared::Cell c(s_color, ' ');
         TUI_Shared::g_consoleData(a_x, a_y) = c;
+        TUI_Shared::g_consoleData.MarkDrawn(a_y, a_x, a_x + 1);
     }
 }
 
@@ -546,9 +757,89 @@ void TUI::DrawTextV(int a_x, int a_y, const char* a_format, va_list args)
             TUI_Shared::g_consoleData(a_x + i, a_y) = c;
         }
     }
+    TUI_Shared::g_consoleData.MarkDrawn(a_y, a_x, a_x + (int)n);
 }
 
-#if defined(_WIN32)
+#if defined(HAS_ANSI) || defined(HAS_NCURSES)
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+
+// both terminal backends wait in poll() on stdin and a self-pipe. the pipe gets a byte for every Wake and SIGWINCH,
+// so neither can get lost between the last frame and the wait
+namespace TUI_Posix
+{
+
+int g_wakePipe[2] = { -1, -1 };
+struct sigaction g_oldResizeAction;
+
+static void OnResize(int a_signal)
+{
+    const int savedErrno = errno;
+    TUI::Wake();
+    errno = savedErrno;
+    // ncurses has its own handler for the resize
+    if ((g_oldResizeAction.sa_flags & SA_SIGINFO) == 0 &&
+        g_oldResizeAction.sa_handler != SIG_DFL &&
+        g_oldResizeAction.sa_handler != SIG_IGN)
+    {
+        g_oldResizeAction.sa_handler(a_signal);
+    }
+}
+
+// after the backend is set up, so a handler it installed is kept
+static void InitWake()
+{
+    if (g_wakePipe[0] >= 0 || pipe(g_wakePipe) != 0)
+        return;
+    for (int fd : g_wakePipe)
+    {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = OnResize;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGWINCH, &action, &g_oldResizeAction);
+}
+
+} // namespace TUI_Posix
+
+void TUI::Wake()
+{
+    // a full pipe already has a wakeup pending
+    if (TUI_Posix::g_wakePipe[1] >= 0)
+    {
+        const char c = 0;
+        (void)!write(TUI_Posix::g_wakePipe[1], &c, 1);
+    }
+}
+
+void TUI::WaitForEvents()
+{
+    if (TUI_Posix::g_wakePipe[0] < 0)
+        return;
+    struct pollfd fds[2];
+    fds[0].fd     = STDIN_FILENO;
+    fds[0].events = POLLIN;
+    fds[1].fd     = TUI_Posix::g_wakePipe[0];
+    fds[1].events = POLLIN;
+    while (poll(fds, 2, -1) < 0 && errno == EINTR)
+    {
+    }
+    char drain[64];
+    while (read(TUI_Posix::g_wakePipe[0], drain, sizeof(drain)) > 0)
+    {
+    }
+}
+#endif
+
+#if defined(TUI_NO_PLATFORM)
+// drawing and TUI_Shared::PresentDirty only, for tools that measure them without a terminal
+#elif defined(_WIN32)
 // Windows-Header-Diet:
 #define WIN32_LEAN_AND_MEAN
 #define NOWINMESSAGES
@@ -612,6 +903,7 @@ static void Assert(bool a_condition, TCHAR* a_format, ...)
 static struct ConsoleState
 {
     HANDLE oldHandle;
+    HANDLE wakeEvent   = nullptr;
     bool isInitialized = false;
 } g_consoleState;
 static struct ConsoleBuffer
@@ -834,6 +1126,8 @@ void TUI::Init(bool a_doubleBuffered)
 
     TUI_Platform::PresentBuffer();
 
+    // auto reset: one WaitForEvents ends per Wake
+    TUI_Platform::g_consoleState.wakeEvent     = CreateEvent(nullptr, FALSE, FALSE, nullptr);
     TUI_Platform::g_consoleState.isInitialized = true;
 
     atexit(TUI_Platform::RestoreConsole);
@@ -896,30 +1190,381 @@ void TUI::BeginFrame(bool& out_sizeChanged)
 
 void TUI::EndFrame(int a_targetFps)
 {
-    HANDLE console            = TUI_Platform::g_consoleBuffer.handle;
-    TUI_Shared::Buffer& cache = TUI_Platform::g_consoleBuffer.data;
-    TUI_Shared::Buffer& data  = TUI_Shared::g_consoleData;
-    if (cache.width != data.width || cache.height != data.height)
-        cache.Resize(data.width, data.height);
-
+    HANDLE console = TUI_Platform::g_consoleBuffer.handle;
     DWORD written;
-    for (int y = 0; y < data.height; ++y)
+    TUI_Shared::PresentDirty(TUI_Shared::g_consoleData, TUI_Platform::g_consoleBuffer.data, [&](int a_x, int a_y, const TUI_Shared::Cell& a_cell) {
+        const COORD coord = { (SHORT)a_x, (SHORT)a_y };
+        const WORD color  = a_cell.color;
+        const char value  = a_cell.value;
+        WriteConsoleOutputAttribute(console, &color, 1, coord, &written);
+        WriteConsoleOutputCharacter(console, &value, 1, coord, &written);
+    });
+
+    TUI_Shared::g_frameTimer.EndFrame(a_targetFps);
+}
+
+void TUI::WaitForEvents()
+{
+    // resizing the window does not signal the input handle, the timeout picks it up
+    HANDLE handles[2] = { GetStdHandle(STD_INPUT_HANDLE), TUI_Platform::g_consoleState.wakeEvent };
+    WaitForMultipleObjects(handles[1] ? 2 : 1, handles, FALSE, 250);
+}
+
+void TUI::Wake()
+{
+    if (TUI_Platform::g_consoleState.wakeEvent)
+        SetEvent(TUI_Platform::g_consoleState.wakeEvent);
+}
+
+#elif defined(HAS_ANSI)
+#include <errno.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+// straight to the terminal: termios for the input, escape sequences for the output. g_consoleBuffer.data is the
+// only copy of what the terminal shows, a frame is diffed against it once and goes out with a single write().
+namespace TUI_Platform
+{
+
+static struct ConsoleState
+{
+    struct termios oldAttributes;
+    bool isInitialized = false;
+} g_consoleState;
+static struct ConsoleBuffer
+{
+    int width     = -1;
+    int height    = -1;
+    int oldWidth  = -1;
+    int oldHeight = -1;
+    TUI_Shared::Buffer data;
+} g_consoleBuffer;
+// the frame's escape sequences, kept to not allocate every frame
+std::vector<char> g_output;
+
+static void WriteAll(const char* a_data, size_t a_size)
+{
+    while (a_size > 0)
+    {
+        const ssize_t n = write(STDOUT_FILENO, a_data, a_size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+        a_data += n;
+        a_size -= (size_t)n;
+    }
+}
+
+static void RestoreConsole()
+{
+    if (g_consoleState.isInitialized)
+    {
+        // default colors, cursor back on, leave the alternate screen
+        static const char s_restore[] = "\033[0m\033[?25h\033[?1049l";
+        WriteAll(s_restore, sizeof(s_restore) - 1);
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &g_consoleState.oldAttributes);
+        g_consoleState.isInitialized = false;
+    }
+}
+
+static void SignalHandler(int a_signal)
+{
+    RestoreConsole();
+    signal(a_signal, SIG_DFL);
+    raise(a_signal);
+}
+
+static TUI::EKeys MapChar(int a_c)
+{
+    if (a_c >= 'a' && a_c <= 'z')
+        return (TUI::EKeys)((int)TUI::EKeys::Key_A + a_c - 'a');
+    if (a_c >= 'A' && a_c <= 'Z')
+        return (TUI::EKeys)((int)TUI::EKeys::Key_A + a_c - 'A');
+    if (a_c >= '0' && a_c <= '9')
+        return (TUI::EKeys)((int)TUI::EKeys::Key_0 + a_c - '0');
+    switch (a_c)
+    {
+        case ' ': return TUI::EKeys::Key_Space;
+        case '\'': return TUI::EKeys::Key_Apostrophe;
+        case ',': return TUI::EKeys::Key_Comma;
+        case '-': return TUI::EKeys::Key_Minus;
+        case '.': return TUI::EKeys::Key_Period;
+        case '/': return TUI::EKeys::Key_Slash;
+        case ';': return TUI::EKeys::Key_Semicolon;
+        case '=': return TUI::EKeys::Key_Equal;
+        case '[': return TUI::EKeys::Key_LeftBracket;
+        case '\\': return TUI::EKeys::Key_Backslash;
+        case ']': return TUI::EKeys::Key_RightBracket;
+        case '`': return TUI::EKeys::Key_GraveAccent;
+        case '\t': return TUI::EKeys::Key_Tab;
+        case '\r':
+        case '\n': return TUI::EKeys::Key_Enter;
+        case 8:
+        case 127: return TUI::EKeys::Key_Backspace;
+        case 27: return TUI::EKeys::Key_Escape;
+    }
+    return TUI::EKeys::Key_None;
+}
+
+// the key of the escape sequence at a_input (after the ESC), out_length receives its length
+static TUI::EKeys MapSequence(const char* a_input, int a_size, int& out_length)
+{
+    out_length = 0;
+    if (a_size < 2 || (a_input[0] != '[' && a_input[0] != 'O'))
+    {
+        return TUI::EKeys::Key_Escape;
+    }
+    // ESC [ or ESC O, optional numeric parameters, one final character
+    int i     = 1;
+    int param = 0;
+    while (i < a_size && ((a_input[i] >= '0' && a_input[i] <= '9') || a_input[i] == ';'))
+    {
+        if (a_input[i] != ';' && param < 1000)
+            param = param * 10 + (a_input[i] - '0');
+        ++i;
+    }
+    if (i >= a_size)
+    {
+        out_length = a_size;
+        return TUI::EKeys::Key_None;
+    }
+    out_length = i + 1;
+    switch (a_input[i])
+    {
+        case 'A': return TUI::EKeys::Key_Up;
+        case 'B': return TUI::EKeys::Key_Down;
+        case 'C': return TUI::EKeys::Key_Right;
+        case 'D': return TUI::EKeys::Key_Left;
+        case 'H': return TUI::EKeys::Key_Home;
+        case 'F': return TUI::EKeys::Key_End;
+        case 'M': return TUI::EKeys::Key_KpEnter;
+        case 'P': return TUI::EKeys::Key_F1;
+        case 'Q': return TUI::EKeys::Key_F2;
+        case 'R': return TUI::EKeys::Key_F3;
+        case 'S': return TUI::EKeys::Key_F4;
+        case '~':
+            switch (param)
+            {
+                case 1:
+                case 7: return TUI::EKeys::Key_Home;
+                case 2: return TUI::EKeys::Key_Insert;
+                case 3: return TUI::EKeys::Key_Delete;
+                case 4:
+                case 8: return TUI::EKeys::Key_End;
+                case 5: return TUI::EKeys::Key_PageUp;
+                case 6: return TUI::EKeys::Key_PageDown;
+                case 11: return TUI::EKeys::Key_F1;
+                case 12: return TUI::EKeys::Key_F2;
+                case 13: return TUI::EKeys::Key_F3;
+                case 14: return TUI::EKeys::Key_F4;
+                case 15: return TUI::EKeys::Key_F5;
+                case 17: return TUI::EKeys::Key_F6;
+                case 18: return TUI::EKeys::Key_F7;
+                case 19: return TUI::EKeys::Key_F8;
+                case 20: return TUI::EKeys::Key_F9;
+                case 21: return TUI::EKeys::Key_F10;
+                case 23: return TUI::EKeys::Key_F11;
+                case 24: return TUI::EKeys::Key_F12;
+            }
+            break;
+    }
+    return TUI::EKeys::Key_None;
+}
+
+static void PollInput()
+{
+    TUI_Shared::g_input.keys.Reset();
+
+    // the terminal is set to return whatever is there without waiting
+    char input[256];
+    ssize_t n;
+    while ((n = read(STDIN_FILENO, input, sizeof(input))) > 0)
     {
-        for (int x = 0; x < data.width; ++x)
+        for (int i = 0; i < (int)n; ++i)
         {
-            const TUI_Shared::Cell& dataCell = data(x, y);
-            TUI_Shared::Cell& cacheCell      = cache(x, y);
-            if (cacheCell.raw != dataCell.raw)
+            TUI::EKeys key = TUI::EKeys::Key_None;
+            if (input[i] == 27 && i + 1 < (int)n)
             {
-                const COORD coord = { (SHORT)x, (SHORT)y };
-                const WORD color  = dataCell.color;
-                const char value  = dataCell.value;
-                WriteConsoleOutputAttribute(console, &color, 1, coord, &written);
-                WriteConsoleOutputCharacter(console, &value, 1, coord, &written);
-                cacheCell = dataCell;
+                int length;
+                key = MapSequence(input + i + 1, (int)n - i - 1, length);
+                i += length;
+            }
+            else
+            {
+                key = MapChar((unsigned char)input[i]);
+            }
+            if (key != TUI::EKeys::Key_None)
+            {
+                int keyId                       = (int)key;
+                TUI_Shared::g_input.keys[keyId] = true;
             }
         }
     }
+}
+
+static void Append(const char* a_text, int a_length)
+{
+    g_output.insert(g_output.end(), a_text, a_text + a_length);
+}
+
+static void AppendFormat(const char* a_format, int a_first, int a_second = 0)
+{
+    char buffer[32];
+    const int n = snprintf(buffer, sizeof(buffer), a_format, a_first, a_second);
+    Append(buffer, n);
+}
+
+// TUI::EColors are in the order of the PC text mode (blue = 1, red = 4), ANSI has red and blue swapped
+static int ToAnsiColor(int a_color)
+{
+    return (a_color & 0xA) | ((a_color & 1) << 2) | ((a_color >> 2) & 1);
+}
+
+static void AppendColor(uint8_t a_color)
+{
+    if (a_color == 0)
+    {
+        // like the erase char, the terminal's own colors
+        Append("\033[0m", 4);
+        return;
+    }
+    const TUI::Color color(a_color);
+    const int fg = ToAnsiColor((int)color.foreground);
+    const int bg = ToAnsiColor((int)color.background);
+    AppendFormat("\033[%d;%dm", fg < 8 ? 30 + fg : 82 + fg, bg < 8 ? 40 + bg : 92 + bg);
+}
+
+} // namespace TUI_Platform
+
+void TUI::Init(bool a_doubleBuffered)
+{
+    if (TUI_Platform::g_consoleState.isInitialized)
+        return;
+
+    // no line buffering and no echo, reads never wait. signals stay on, their handlers restore the terminal
+    struct termios attributes;
+    tcgetattr(STDIN_FILENO, &TUI_Platform::g_consoleState.oldAttributes);
+    attributes = TUI_Platform::g_consoleState.oldAttributes;
+    attributes.c_iflag &= ~(IXON | ICRNL);
+    attributes.c_lflag &= ~(ICANON | ECHO);
+    attributes.c_cc[VMIN]  = 0;
+    attributes.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &attributes);
+
+    // alternate screen, no cursor, cleared
+    static const char s_init[] = "\033[?1049h\033[?25l\033[0m\033[2J";
+    TUI_Platform::WriteAll(s_init, sizeof(s_init) - 1);
+
+    TUI_Platform::g_consoleState.isInitialized = true;
+
+    atexit(TUI_Platform::RestoreConsole);
+    signal(SIGINT, TUI_Platform::SignalHandler);
+    signal(SIGTERM, TUI_Platform::SignalHandler);
+    signal(SIGHUP, TUI_Platform::SignalHandler);
+    TUI_Posix::InitWake();
+}
+
+void TUI::Shutdown()
+{
+    TUI_Platform::RestoreConsole();
+}
+
+void TUI::BeginFrame(bool& out_sizeChanged)
+{
+    TUI_Shared::g_frameTimer.BeginFrame();
+
+    TUI_Platform::PollInput();
+
+    TUI_Platform::ConsoleBuffer& buffer = TUI_Platform::g_consoleBuffer;
+    struct winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0 && size.ws_row > 0)
+    {
+        buffer.width  = size.ws_col;
+        buffer.height = size.ws_row;
+    }
+    else
+    {
+        buffer.width  = 80;
+        buffer.height = 24;
+    }
+    if (buffer.width != buffer.oldWidth ||
+        buffer.height != buffer.oldHeight)
+    {
+        buffer.oldWidth  = buffer.width;
+        buffer.oldHeight = buffer.height;
+
+        out_sizeChanged = true;
+    }
+
+    TUI_Shared::Buffer& data = TUI_Shared::g_consoleData;
+    if (buffer.width != data.width ||
+        buffer.height != data.height)
+    {
+        data.Resize(buffer.width, buffer.height);
+        out_sizeChanged = true;
+    }
+}
+
+void TUI::EndFrame(int a_targetFps)
+{
+    std::vector<char>& output       = TUI_Platform::g_output;
+    TUI_Shared::Buffer& cache       = TUI_Platform::g_consoleBuffer.data;
+    const TUI_Shared::Buffer& data  = TUI_Shared::g_consoleData;
+    static int s_color              = -1; // the terminal's current colors, -1 if unknown
+    output.clear();
+    if (cache.width != data.width || cache.height != data.height)
+    {
+        // the terminal reflowed whatever it showed, start over from an empty screen
+        TUI_Platform::Append("\033[0m\033[2J", 8);
+        s_color = 0;
+    }
+
+    // the cursor is unknown at the start of a frame and after writing into the last column (the terminal may wrap)
+    int cursorX = -1;
+    int cursorY = -1;
+    TUI_Shared::PresentRuns(TUI_Shared::g_consoleData, cache, [&](int a_x, int a_y, uint8_t a_color, const char* a_text, int a_length) {
+        const int gap = a_x - cursorX;
+        if (a_y == cursorY && gap > 0 && gap <= 4)
+        {
+            // a few cells in between are shorter to write again than to move over, if they are in the current colors
+            bool sameColor = true;
+            for (int x = cursorX; x < a_x && sameColor; ++x)
+                sameColor = data(x, a_y).color == s_color;
+            if (sameColor)
+            {
+                for (int x = cursorX; x < a_x; ++x)
+                    output.push_back((char)data(x, a_y).value);
+            }
+            else
+            {
+                TUI_Platform::AppendFormat("\033[%dC", gap);
+            }
+        }
+        else if (a_y != cursorY || a_x != cursorX)
+        {
+            if (a_y == cursorY && a_x > cursorX)
+                TUI_Platform::AppendFormat("\033[%dC", a_x - cursorX);
+            else if (a_y == cursorY + 1 && cursorY >= 0 && a_x == 0)
+                TUI_Platform::Append("\r\n", 2);
+            else
+                TUI_Platform::AppendFormat("\033[%d;%dH", a_y + 1, a_x + 1);
+        }
+        if (a_color != s_color)
+        {
+            TUI_Platform::AppendColor(a_color);
+            s_color = a_color;
+        }
+        TUI_Platform::Append(a_text, a_length);
+        cursorX = a_x + a_length;
+        cursorY = a_y;
+        if (cursorX >= data.width)
+            cursorX = cursorY = -1;
+    });
+    if (!output.empty())
+        TUI_Platform::WriteAll(output.data(), output.size());
 
     TUI_Shared::g_frameTimer.EndFrame(a_targetFps);
 }
@@ -1114,6 +1759,7 @@ void TUI::Init(bool a_doubleBuffered)
     wtimeout(stdscr, 1);
     set_escdelay(25);
     keypad(stdscr, true);
+    TUI_Posix::InitWake();
 
     TUI_Platform::g_consoleState.isInitialized = true;
 
@@ -1153,41 +1799,18 @@ void TUI::BeginFrame(bool& out_sizeChanged)
 
 void TUI::EndFrame(int a_targetFps)
 {
-    wrefresh(stdscr);
-
-    TUI_Shared::Buffer& cache = TUI_Platform::g_consoleBuffer.data;
-    TUI_Shared::Buffer& data  = TUI_Shared::g_consoleData;
-    if (cache.width != data.width || cache.height != data.height)
-        cache.Resize(data.width, data.height);
-
-    int activeColor = 0xFFFFFFFF;
-    for (int y = 0; y < data.height; ++y)
-    {
-        for (int x = 0; x < data.width; ++x)
+    // one attribute change and one positioned string per run, instead of a cursor move and a character per cell
+    int activeColor = -1;
+    TUI_Shared::PresentRuns(TUI_Shared::g_consoleData, TUI_Platform::g_consoleBuffer.data, [&](int a_x, int a_y, uint8_t a_color, const char* a_text, int a_length) {
+        if (a_color != activeColor)
         {
-            const TUI_Shared::Cell& dataCell = data(x, y);
-            TUI_Shared::Cell& cacheCell      = cache(x, y);
-            if (cacheCell.raw != dataCell.raw)
-            {
-                if (dataCell.color != activeColor)
-                {
-                    if (dataCell.color == 0)
-                    {
-                        attrset(A_NORMAL);
-                        attron(COLOR_PAIR(0));
-                    }
-                    else
-                    {
-                        int pair = TUI_Platform::g_colorPairs(dataCell.color);
-                        attron(COLOR_PAIR(pair));
-                    }
-                    activeColor = dataCell.color;
-                }
-                mvaddch(y, x, dataCell.value);
-                cacheCell = dataCell;
-            }
+            attrset(a_color == 0 ? A_NORMAL : COLOR_PAIR(TUI_Platform::g_colorPairs(a_color)));
+            activeColor = a_color;
         }
-    }
+        mvaddnstr(a_y, a_x, a_text, a_length);
+    });
+    // the frame goes out now, not with the next one
+    wrefresh(stdscr);
 
     TUI_Shared::g_frameTimer.EndFrame(a_targetFps);
 }
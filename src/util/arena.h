@@ -0,0 +1,75 @@
+#pragma once
+
+#include <memory>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// bump allocator for trivially destructible objects: allocations are never freed one by one, Reset() drops all
+// of them at once and keeps the blocks for reuse. blocks are only ever added, so pointers stay valid until Reset().
+struct Arena
+{
+    explicit Arena(size_t a_blockSize = 1 << 20)
+        : m_blockSize(a_blockSize)
+        , m_block(0)
+        , m_offset(0)
+        , m_used(0)
+    {
+    }
+
+    // nullptr if a_size does not fit into a block
+    void* Allocate(size_t a_size, size_t a_align)
+    {
+        if (a_size > m_blockSize)
+        {
+            return nullptr;
+        }
+        size_t offset = (m_offset + a_align - 1) & ~(a_align - 1);
+        if (m_blocks.empty() || offset + a_size > m_blockSize)
+        {
+            // on to the next block, recycled from before the last Reset() if there is one
+            if (!m_blocks.empty())
+                ++m_block;
+            if (m_block == m_blocks.size())
+                m_blocks.push_back(std::unique_ptr<uint8_t[]>(new uint8_t[m_blockSize]));
+            offset = 0;
+        }
+        m_offset = offset + a_size;
+        m_used += a_size;
+        return m_blocks[m_block].get() + offset;
+    }
+    template <typename T>
+    T* New()
+    {
+        void* memory = Allocate(sizeof(T), alignof(T));
+        return memory ? new (memory) T() : nullptr;
+    }
+    template <typename T>
+    T* NewArray(size_t a_count)
+    {
+        T* items = (T*)Allocate(sizeof(T) * a_count, alignof(T));
+        for (size_t i = 0; items && i < a_count; ++i)
+        {
+            new (items + i) T();
+        }
+        return items;
+    }
+
+    void Reset()
+    {
+        m_block  = 0;
+        m_offset = 0;
+        m_used   = 0;
+    }
+
+    size_t GetBytesUsed() const { return m_used; }
+    size_t GetBytesReserved() const { return m_blocks.size() * m_blockSize; }
+
+private:
+    std::vector<std::unique_ptr<uint8_t[]>> m_blocks;
+    size_t m_blockSize;
+    size_t m_block;
+    size_t m_offset;
+    size_t m_used;
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads for fork/join style loops. the calling thread takes part in every loop,
+// so a pool of N threads starts N - 1 workers. loops must not be nested or started from several threads.
+struct ThreadPool
+{
+    typedef std::function<void(size_t a_index, int a_thread)> Task;
+
+    explicit ThreadPool(int a_threads)
+        : m_task(nullptr)
+        , m_count(0)
+        , m_nextIndex(0)
+        , m_busy(0)
+        , m_generation(0)
+        , m_quit(false)
+    {
+        for (int i = 1; i < a_threads; ++i)
+        {
+            m_workers.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+        }
+    }
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    int GetThreadCount() const { return (int)m_workers.size() + 1; }
+
+    // runs a_task for every index in [0, a_count) and returns once all of them finished.
+    // a_thread is in [0, GetThreadCount()), 0 being the calling thread.
+    void ParallelFor(size_t a_count, const Task& a_task)
+    {
+        if (m_workers.empty())
+        {
+            for (size_t i = 0; i < a_count; ++i)
+            {
+                a_task(i, 0);
+            }
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_task  = &a_task;
+            m_count = a_count;
+            m_nextIndex.store(0);
+            m_busy = (int)m_workers.size();
+            ++m_generation;
+        }
+        m_wake.notify_all();
+        RunTasks(0);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this]() { return m_busy == 0; });
+        m_task = nullptr;
+    }
+
+private:
+    void RunTasks(int a_thread)
+    {
+        for (size_t i = m_nextIndex++; i < m_count; i = m_nextIndex++)
+        {
+            (*m_task)(i, a_thread);
+        }
+    }
+    void WorkerLoop(int a_thread)
+    {
+        uint64_t seen = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [&]() { return m_quit || m_generation != seen; });
+                if (m_quit)
+                    return;
+                seen = m_generation;
+            }
+            RunTasks(a_thread);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (--m_busy == 0)
+                    m_done.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    const Task* m_task;
+    size_t m_count;
+    std::atomic<size_t> m_nextIndex;
+    int m_busy;
+    uint64_t m_generation;
+    bool m_quit;
+};